@@ -988,11 +988,124 @@
 
 (defprop spaceout wxxml-spaceout wxxml)
 
+;;
+;; Framed output
+;;
+;; When wxMaxima asks for it with wx-set-framing, results are sent as
+;; records: STX, a type character, the length of the payload in
+;; characters, a colon, the payload and ETX. Prompts are sent as
+;; records without the length. Types are
+;;   A  acknowledges wx-set-framing
+;;   E  error message which ended an evaluation
+;;   M  math
+;;   I  math with an image or a slideshow
+;;   P  prompt
+;;   Q  a question follows, see wx-call-with-answer
+;;   S  symbols for autocompletion, separated by $
+;;
+
+(defvar *wx-framing* nil)
+
+(defun wx-frame (type payload)
+  (format t "~c~a~d:~a~c" (code-char 2) type (length payload) payload (code-char 3)))
+
+(defvar *wx-merror* (symbol-function 'merror))
+
+;; Sends the message of an error which is not caught by errcatch as an
+;; E record. merror throws to the top level, so the message is sent
+;; while unwinding. Expressions in the message are not framed.
+(defun wx-merror (sstring &rest l)
+  (declare (special errcatch))
+  (if (or (not *wx-framing*) errcatch
+          (and (boundp '*mdebug*) (symbol-value '*mdebug*)))
+      (apply *wx-merror* sstring l)
+      (let ((message (make-string-output-stream)))
+        (unwind-protect
+             (let ((*standard-output* message)
+                   (*wx-framing* nil))
+               (apply *wx-merror* sstring l))
+          (wx-frame "E" (get-output-stream-string message))))))
+
+(setf (symbol-function 'merror) #'wx-merror)
+
+;; wxMaxima sends cells before maxima is done with the previous one and
+;; marks them with *wx-ahead*. They must not be read as the answer to a
+;; question: a Q record asks wxMaxima to send *wx-answer-mark*, and the
+;; input up to the mark is read before the question is asked. Marked
+;; cells are dropped, wxMaxima sends them again after the question.
+;; Other input, like the rest of the line which asked, is read first.
+(defvar *wx-ahead* "/*wx-ahead*/")
+(defvar *wx-answer-mark* "/*wx-answer*/")
+
+(defun wx-starts-with (prefix s)
+  (and (>= (length s) (length prefix))
+       (string= prefix s :end2 (length prefix))))
+
+(defun wx-call-with-answer (fun args)
+  (if (not *wx-framing*)
+      (apply fun args)
+      (let ((in *query-io*)
+            (kept nil))
+        (wx-frame "Q" "1")
+        (finish-output)
+        (loop
+           (let ((line (read-line in nil nil)))
+             (cond ((or (null line) (wx-starts-with *wx-answer-mark* line))
+                    (return))
+                   ((not (wx-starts-with *wx-ahead* line))
+                    (push line kept)))))
+        (let* ((input (make-concatenated-stream
+                       (make-string-input-stream
+                        (format nil "~{~a~%~}" (reverse kept)))
+                       in))
+               (*query-io* (make-two-way-stream input in))
+               (*standard-input* *query-io*))
+          (apply fun args)))))
+
+(defvar *wx-retrieve* (symbol-function 'retrieve))
+
+(defun wx-retrieve (&rest args)
+  (wx-call-with-answer *wx-retrieve* args))
+
+(setf (symbol-function 'retrieve) #'wx-retrieve)
+
+(defvar *wx-readonly* (symbol-function '$readonly))
+
+(defun wx-readonly (&rest args)
+  (wx-call-with-answer *wx-readonly* args))
+
+(setf (symbol-function '$readonly) #'wx-readonly)
+
+(defun wx-set-framing (on)
+  (setq *wx-framing* on)
+  (cond (on
+         (setf *prompt-prefix* (format nil "~cP:" (code-char 2)))
+         (setf *prompt-suffix* (string (code-char 3)))
+         (wx-frame "A" "1"))))
+
+(defun wx-symbols (symbols)
+  (let ((*print-circle* nil))
+    (if *wx-framing*
+        (wx-frame "S" (format nil "~{~a~^$~}" symbols))
+        (format t "<wxxml-symbols>~{~a~^$~}</wxxml-symbols>" symbols))))
+
+(defun wxxml-image-p (x)
+  (let ((e (if (and (consp x) (consp (car x)) (eq (caar x) 'mlable))
+               (caddr x)
+               x)))
+    (and (consp e) (consp (car e)) (eq (caar e) 'wxxmltag)
+         (member (caddr e) '("img" "slide") :test #'equal))))
+
 (defun mydispla (x)
   (let ((*print-circle* nil)
         (*wxxml-mratp* (format nil "~{~a~}" (cdr (checkrat x)))))
-    (mapc #'princ
-          (wxxml x '("<mth>") '("</mth>") 'mparen 'mparen))))
+    (if *wx-framing*
+        (wx-frame (if (wxxml-image-p x) "I" "M")
+                  (with-output-to-string (*standard-output*)
+                    (mapc #'princ
+                          (wxxml x '("<mth>") '("</mth>") 'mparen 'mparen))))
+        (mapc #'princ
+              (wxxml x '("<mth>") '("</mth>") 'mparen 'mparen)))))
 
 (setf *alt-display2d* 'mydispla)
 
@@ -1573,7 +1686,7 @@
 
 (defun $add_function_template (&rest functs)
   (let ((*print-circle* nil))
-    (format t "<wxxml-symbols>~{~a~^$~}</wxxml-symbols>" (mapcar #'$print_function functs))
+    (wx-symbols (mapcar #'$print_function functs))
     (cons '(mlist simp) functs)))
 
 ;;;
@@ -1590,7 +1703,7 @@
      (case type
        (($maxima)
 	($batchload searched-for)
-	(format t "<wxxml-symbols>~{~a~^$~}</wxxml-symbols>"
+	(wx-symbols
 		(append (mapcar #'$print_function (cdr ($append $functions $macros)))
 			(mapcar #'symbol-to-string (cdr $values)))))
        (($lisp $object)
@@ -1652,10 +1765,43 @@
     ($ldisp (cons (append '($matrix simp) mtrx) (cdr mat)))
     '$done))
 
+;;
+;; Session snapshots
+;;
+;; wx-save-session writes the values, functions and other definitions
+;; of the session to file with save(file, all). The first line of the
+;; file is a comment with key, which wxMaxima checks before it asks
+;; for the file to be restored with wx-restore-session. The snapshot
+;; is written to a temporary file which replaces file when it is
+;; complete, so file never holds the key of a partial snapshot.
+;;
+
+(defun wx-save-session (file key)
+  (let ((tmp (concatenate 'string file ".tmp"))
+        (new (concatenate 'string file ".new")))
+    (ignore-errors
+      (meval `(($save) ,tmp $all))
+      (with-open-file (out new :direction :output :if-exists :supersede)
+        (format out ";; wxMaxima session ~a~%" key)
+        (with-open-file (in tmp)
+          (loop for line = (read-line in nil) while line
+                do (write-line line out))))
+      (delete-file tmp)
+      ;; Some lisps don't rename over an existing file
+      (when (probe-file file)
+        (delete-file file))
+      (rename-file new file))))
+
+(defun wx-restore-session (file)
+  (when (ignore-errors (load file))
+    (let ((*print-circle* nil))
+      (wx-symbols
+       (append (mapcar #'$print_function (cdr ($append $functions $macros)))
+               (mapcar #'symbol-to-string (cdr $values)))))))
+
 ;; Load the initial functions (from mac-init.mac)
 (let ((*print-circle* nil))
-  (format t "<wxxml-symbols>~{~a~^$~}</wxxml-symbols>"
-	  (mapcar #'$print_function (cdr ($append $functions $macros)))))
+  (wx-symbols (mapcar #'$print_function (cdr ($append $functions $macros)))))
 
 (no-warning
  (defun mredef-check (fnname)
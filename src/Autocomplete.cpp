@@ -21,6 +21,10 @@
 
 #include <wx/textfile.h>
 
+wxString AutoComplete::s_indexFile;
+wxArrayString AutoComplete::s_symbolList;
+wxArrayString AutoComplete::s_templateList;
+
 AutoComplete::AutoComplete()
 {
   m_args.Compile(wxT("[[]<([^>]*)>[]]"));
@@ -31,6 +35,14 @@ bool AutoComplete::LoadSymbols(wxString file)
   if (!wxFileExists(file))
     return false;
 
+  // Windows opened later don't have to read the index again
+  if (file == s_indexFile)
+  {
+    m_symbolList = s_symbolList;
+    m_templateList = s_templateList;
+    return false;
+  }
+
   if (m_symbolList.GetCount() > 0)
     m_symbolList.Empty();
   if (m_templateList.GetCount() > 0)
@@ -112,6 +124,10 @@ bool AutoComplete::LoadSymbols(wxString file)
 
   m_symbolList.Sort();
 
+  s_indexFile = file;
+  s_symbolList = m_symbolList;
+  s_templateList = m_templateList;
+
   return false;
 }
 
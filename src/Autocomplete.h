@@ -36,6 +36,10 @@ private:
   wxArrayString m_symbolList;
   wxArrayString m_templateList;
   wxRegEx m_args;
+  // The lists from the last file read, shared by all windows
+  static wxString s_indexFile;
+  static wxArrayString s_symbolList;
+  static wxArrayString s_templateList;
 };
 
 #endif
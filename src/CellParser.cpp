@@ -23,6 +23,8 @@
 #include <wx/config.h>
 #include "MathCell.h"
 
+FontCache CellParser::s_fonts;
+
 CellParser::CellParser(wxDC& dc) : m_dc(dc)
 {
   m_scale = 1.0;
@@ -311,6 +313,29 @@ bool CellParser::IsUnderlined(int st)
   return m_styles[st].underlined;
 }
 
+const wxFont& CellParser::GetFont(int fontsize, int style, int weight, bool underlined,
+                                  const wxString& face, wxFontEncoding encoding)
+{
+  wxString key = wxString::Format(wxT("%d %d %d %d %d "), fontsize, style, weight,
+                                  underlined, encoding) + face;
+
+  FontCache::iterator it = s_fonts.find(key);
+  if (it != s_fonts.end())
+    return *(it->second);
+
+  wxFont *font = new wxFont(fontsize, wxFONTFAMILY_MODERN, style, weight,
+                            underlined, face, encoding);
+  s_fonts[key] = font;
+  return *font;
+}
+
+void CellParser::ClearFonts()
+{
+  for (FontCache::iterator it = s_fonts.begin(); it != s_fonts.end(); ++it)
+    delete it->second;
+  s_fonts.clear();
+}
+
 wxString CellParser::GetSymbolFontName()
 {
 #if defined __WXMSW__
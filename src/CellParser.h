@@ -22,11 +22,14 @@
 
 #include <wx/wx.h>
 #include <wx/fontenum.h>
+#include <wx/hashmap.h>
 
 #include "TextStyle.h"
 
 #include "Setup.h"
 
+WX_DECLARE_STRING_HASH_MAP(wxFont*, FontCache);
+
 class CellParser
 {
 public:
@@ -55,6 +58,11 @@ public:
   wxFontWeight IsBold(int st);
   int IsItalic(int st);
   bool IsUnderlined(int st);
+  // Fonts are created once and shared by all cells, see s_fonts
+  static const wxFont& GetFont(int fontsize, int style, int weight, bool underlined,
+                               const wxString& face,
+                               wxFontEncoding encoding = wxFONTENCODING_DEFAULT);
+  static void ClearFonts();
   void ReadStyle();
   void SetForceUpdate(bool force)
   {
@@ -114,6 +122,9 @@ private:
   int m_clientWidth;
   wxFontEncoding m_fontEncoding;
   style m_styles[STYLE_NUM];
+  // Creating a wxFont looks up the font in the system each time, so
+  // the fonts which were used are kept for the whole session.
+  static FontCache s_fonts;
 };
 
 #endif
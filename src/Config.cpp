@@ -131,12 +131,28 @@ void Config::SetProperties()
   m_getMathFont->SetToolTip(_("Font used for displaying math characters in document."));
   m_changeAsterisk->SetToolTip(_("Use centered dot character for multiplication"));
   m_defaultPort->SetToolTip(_("The default port used for communication between Maxima and wxMaxima."));
+  m_outputLinesLimit->SetToolTip(_("Maximum number of lines of output displayed for one evaluation. Only the end of longer output is displayed. 0 means no limit."));
+  m_outputSizeLimit->SetToolTip(_("Maximum size of output displayed for one evaluation in kB. Only the end of longer output is displayed. 0 means no limit."));
+  m_pipelineDepth->SetToolTip(_("Number of cells which are sent to Maxima before the output of the first one arrives. Needs framed output."));
+  m_kernelCount->SetToolTip(_("Number of additional Maxima processes used by 'Cell->Evaluate Sections in Parallel'. Needs framed output."));
+  m_warmStandby->SetToolTip(_("Keep a second Maxima process running, so that 'Maxima->Restart Maxima' only has to switch to it. Needs framed output."));
+  m_cacheResults->SetToolTip(_("Keep the output of evaluated cells. A cell is not evaluated again if neither its input nor the input of the cells above it has changed."));
+  m_anyPort->SetToolTip(_("Let the system choose a free port for the communication with Maxima instead of searching for one from the default port on."));
+  m_virtualLayout->SetToolTip(_("Lay out only the cells near the visible part of the document. Other cells get an estimated size until they are scrolled into view, so that large documents are displayed at once."));
+  m_singleInstance->SetToolTip(_("Files opened from the command line or the file manager are opened in a new window of the running wxMaxima. With a spare Maxima process the window is ready at once."));
+  m_saveSession->SetToolTip(_("Save the values and functions defined in Maxima next to the document when it is saved, and restore them when the document is opened."));
+  m_framedOutput->SetToolTip(_("Maxima sends its results in records which are faster to read. Takes effect when Maxima is restarted."));
+  m_useStdio->SetToolTip(_("Communicate with Maxima through its standard input and output instead of a network connection. Takes effect when Maxima is restarted. Additional Maxima processes still use the network."));
+  m_parseInThread->SetToolTip(_("Parse the output of Maxima in a separate thread, so that wxMaxima stays responsive while Maxima displays long results."));
 
   wxConfig *config = (wxConfig *)wxConfig::Get();
   wxString mp, mc, ib, mf;
   bool match = true, showLongExpr = false, savePanes = false;
   bool fixedFontTC = true, changeAsterisk = false, usejsmath = true, keepPercent = true;
   bool enterEvaluates = false, saveUntitled = true, openHCaret = false;
+  bool singleInstance = false, anyPort = false, virtualLayout = false;
+  bool parseInThread = false, framedOutput = false, warmStandby = false;
+  bool cacheResults = false, saveSession = false, useStdio = false;
   int rs = 0;
   int lang = wxLANGUAGE_UNKNOWN;
   int panelSize = 1;
@@ -154,8 +170,17 @@ void Config::SetProperties()
   config->Read(wxT("enterEvaluates"), &enterEvaluates);
   config->Read(wxT("saveUntitled"), &saveUntitled);
   config->Read(wxT("openHCaret"), &openHCaret);
+  config->Read(wxT("singleInstance"), &singleInstance);
+  config->Read(wxT("anyPort"), &anyPort);
+  config->Read(wxT("virtualLayout"), &virtualLayout);
   config->Read(wxT("usejsmath"), &usejsmath);
   config->Read(wxT("keepPercent"), &keepPercent);
+  config->Read(wxT("parseInThread"), &parseInThread);
+  config->Read(wxT("framedOutput"), &framedOutput);
+  config->Read(wxT("useStdio"), &useStdio);
+  config->Read(wxT("warmStandby"), &warmStandby);
+  config->Read(wxT("cacheResults"), &cacheResults);
+  config->Read(wxT("saveSession"), &saveSession);
 
   int i = 0;
   for (i = 0; i < LANGUAGE_NUMBER; i++)
@@ -195,6 +220,16 @@ void Config::SetProperties()
     m_maximaProgram->SetValue(wxT("maxima"));
 #endif
   m_additionalParameters->SetValue(mc);
+  m_parseInThread->SetValue(parseInThread);
+  m_framedOutput->SetValue(framedOutput);
+  m_useStdio->SetValue(useStdio);
+#if defined __WXMSW__
+  // Interrupting needs the pid of maxima, not of maxima.bat
+  m_useStdio->Enable(false);
+#endif
+  m_warmStandby->SetValue(warmStandby);
+  m_cacheResults->SetValue(cacheResults);
+  m_saveSession->SetValue(saveSession);
   if (rs == 1)
     m_saveSize->SetValue(true);
   else
@@ -206,6 +241,9 @@ void Config::SetProperties()
   m_enterEvaluates->SetValue(enterEvaluates);
   m_saveUntitled->SetValue(saveUntitled);
   m_openHCaret->SetValue(openHCaret);
+  m_singleInstance->SetValue(singleInstance);
+  m_anyPort->SetValue(anyPort);
+  m_virtualLayout->SetValue(virtualLayout);
   m_fixedFontInTC->SetValue(fixedFontTC);
   m_useJSMath->SetValue(usejsmath);
   m_keepPercentWithSpecials->SetValue(keepPercent);
@@ -267,6 +305,9 @@ wxPanel* Config::CreateOptionsPanel()
   m_enterEvaluates = new wxCheckBox(panel, -1, _("Enter evaluates cells"));
   m_saveUntitled = new wxCheckBox(panel, -1, _("Ask to save untitled documents"));
   m_openHCaret = new wxCheckBox(panel, -1, _("Open a cell when Maxima expects input"));
+  m_singleInstance = new wxCheckBox(panel, -1, _("Open files in the running wxMaxima"));
+  m_anyPort = new wxCheckBox(panel, -1, _("Let the system choose the port"));
+  m_virtualLayout = new wxCheckBox(panel, -1, _("Lay out only the visible part of large documents"));
 
   // TAB 1
   // Maxima options box
@@ -287,8 +328,11 @@ wxPanel* Config::CreateOptionsPanel()
   vsizer->Add(m_enterEvaluates, 0, wxALL, 5);
   vsizer->Add(m_saveUntitled, 0, wxALL, 5);
   vsizer->Add(m_openHCaret, 0, wxALL, 5);
+  vsizer->Add(m_singleInstance, 0, wxALL, 5);
+  vsizer->Add(m_anyPort, 0, wxALL, 5);
+  vsizer->Add(m_virtualLayout, 0, wxALL, 5);
 
-  vsizer->AddGrowableRow(10);
+  vsizer->AddGrowableRow(13);
   panel->SetSizer(vsizer);
   vsizer->Fit(panel);
 
@@ -299,13 +343,38 @@ wxPanel* Config::CreateMaximaPanel()
 {
   wxPanel* panel = new wxPanel(m_notebook, -1);
 
-  wxFlexGridSizer* sizer = new wxFlexGridSizer(5, 2, 0, 0);
+  wxFlexGridSizer* sizer = new wxFlexGridSizer(0, 2, 0, 0);
 
   wxStaticText *mp = new wxStaticText(panel, -1, _("Maxima program:"));
   m_maximaProgram = new wxTextCtrl(panel, -1, wxEmptyString, wxDefaultPosition, wxSize(250, -1), wxTE_RICH);
   m_mpBrowse = new wxButton(panel, wxID_OPEN, _("Open"));
   wxStaticText *ap = new wxStaticText(panel, -1, _("Additional parameters:"));
   m_additionalParameters = new wxTextCtrl(panel, -1, wxEmptyString, wxDefaultPosition, wxSize(250, -1), wxTE_RICH);
+  m_parseInThread = new wxCheckBox(panel, -1, _("Parse output in a separate thread"));
+  m_framedOutput = new wxCheckBox(panel, -1, _("Use framed output"));
+  m_useStdio = new wxCheckBox(panel, -1, _("Use standard input and output"));
+  m_warmStandby = new wxCheckBox(panel, -1, _("Keep a spare Maxima process for restarting"));
+  m_cacheResults = new wxCheckBox(panel, -1, _("Reuse the output of unchanged cells"));
+  m_saveSession = new wxCheckBox(panel, -1, _("Save the Maxima session with the document"));
+  int pipelineDepth = 1;
+  wxConfig::Get()->Read(wxT("pipelineDepth"), &pipelineDepth);
+  wxStaticText *pd = new wxStaticText(panel, -1, _("Cells sent at once:"));
+  m_pipelineDepth = new wxSpinCtrl(panel, -1, wxEmptyString, wxDefaultPosition, wxSize(100, -1), wxSP_ARROW_KEYS, 1, 100, pipelineDepth);
+  m_pipelineDepth->SetValue(pipelineDepth);
+  int kernelCount = 0;
+  wxConfig::Get()->Read(wxT("kernelCount"), &kernelCount);
+  wxStaticText *kc = new wxStaticText(panel, -1, _("Additional Maxima processes:"));
+  m_kernelCount = new wxSpinCtrl(panel, -1, wxEmptyString, wxDefaultPosition, wxSize(100, -1), wxSP_ARROW_KEYS, 0, 64, kernelCount);
+  m_kernelCount->SetValue(kernelCount);
+  int outputLinesLimit = 10000, outputSizeLimit = 10000;
+  wxConfig::Get()->Read(wxT("outputLinesLimit"), &outputLinesLimit);
+  wxConfig::Get()->Read(wxT("outputSizeLimit"), &outputSizeLimit);
+  wxStaticText *ol = new wxStaticText(panel, -1, _("Output limit (lines):"));
+  m_outputLinesLimit = new wxSpinCtrl(panel, -1, wxEmptyString, wxDefaultPosition, wxSize(100, -1), wxSP_ARROW_KEYS, 0, 10000000, outputLinesLimit);
+  m_outputLinesLimit->SetValue(outputLinesLimit);
+  wxStaticText *os = new wxStaticText(panel, -1, _("Output limit (kB):"));
+  m_outputSizeLimit = new wxSpinCtrl(panel, -1, wxEmptyString, wxDefaultPosition, wxSize(100, -1), wxSP_ARROW_KEYS, 0, 10000000, outputSizeLimit);
+  m_outputSizeLimit->SetValue(outputSizeLimit);
 
   sizer->Add(mp, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
   sizer->Add(10, 10);
@@ -316,6 +385,35 @@ wxPanel* Config::CreateMaximaPanel()
   sizer->Add(ap, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
   sizer->Add(10, 10);
   sizer->Add(m_additionalParameters, 0, wxALL, 5);
+  sizer->Add(10, 10);
+  sizer->Add(m_parseInThread, 0, wxALL, 5);
+  sizer->Add(10, 10);
+  sizer->Add(m_framedOutput, 0, wxALL, 5);
+  sizer->Add(10, 10);
+  sizer->Add(m_useStdio, 0, wxALL, 5);
+  sizer->Add(10, 10);
+  sizer->Add(m_warmStandby, 0, wxALL, 5);
+  sizer->Add(10, 10);
+  sizer->Add(m_cacheResults, 0, wxALL, 5);
+  sizer->Add(10, 10);
+  sizer->Add(m_saveSession, 0, wxALL, 5);
+  sizer->Add(10, 10);
+  sizer->Add(pd, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
+  sizer->Add(10, 10);
+  sizer->Add(m_pipelineDepth, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
+  sizer->Add(10, 10);
+  sizer->Add(kc, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
+  sizer->Add(10, 10);
+  sizer->Add(m_kernelCount, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
+  sizer->Add(10, 10);
+  sizer->Add(ol, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
+  sizer->Add(10, 10);
+  sizer->Add(m_outputLinesLimit, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
+  sizer->Add(10, 10);
+  sizer->Add(os, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
+  sizer->Add(10, 10);
+  sizer->Add(m_outputSizeLimit, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
+  sizer->Add(10, 10);
 
   panel->SetSizer(sizer);
   sizer->Fit(panel);
@@ -438,6 +536,16 @@ void Config::WriteSettings()
   wxConfig *config = (wxConfig *)wxConfig::Get();
   config->Write(wxT("maxima"), m_maximaProgram->GetValue());
   config->Write(wxT("parameters"), m_additionalParameters->GetValue());
+  config->Write(wxT("parseInThread"), m_parseInThread->GetValue());
+  config->Write(wxT("framedOutput"), m_framedOutput->GetValue());
+  config->Write(wxT("useStdio"), m_useStdio->GetValue());
+  config->Write(wxT("warmStandby"), m_warmStandby->GetValue());
+  config->Write(wxT("cacheResults"), m_cacheResults->GetValue());
+  config->Write(wxT("saveSession"), m_saveSession->GetValue());
+  config->Write(wxT("pipelineDepth"), m_pipelineDepth->GetValue());
+  config->Write(wxT("kernelCount"), m_kernelCount->GetValue());
+  config->Write(wxT("outputLinesLimit"), m_outputLinesLimit->GetValue());
+  config->Write(wxT("outputSizeLimit"), m_outputSizeLimit->GetValue());
   config->Write(wxT("fontSize"), m_fontSize);
   config->Write(wxT("mathFontsize"), m_mathFontSize);
   config->Write(wxT("matchParens"), m_matchParens->GetValue());
@@ -447,6 +555,9 @@ void Config::WriteSettings()
   config->Write(wxT("enterEvaluates"), m_enterEvaluates->GetValue());
   config->Write(wxT("saveUntitled"), m_saveUntitled->GetValue());
   config->Write(wxT("openHCaret"), m_openHCaret->GetValue());
+  config->Write(wxT("singleInstance"), m_singleInstance->GetValue());
+  config->Write(wxT("anyPort"), m_anyPort->GetValue());
+  config->Write(wxT("virtualLayout"), m_virtualLayout->GetValue());
   config->Write(wxT("defaultPort"), m_defaultPort->GetValue());
   config->Write(wxT("AUI/savePanes"), m_savePanes->GetValue());
   config->Write(wxT("usejsmath"), m_useJSMath->GetValue());
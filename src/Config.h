@@ -100,6 +100,16 @@ protected:
   wxTextCtrl* m_maximaProgram;
   wxButton* m_mpBrowse;
   wxTextCtrl* m_additionalParameters;
+  wxCheckBox* m_parseInThread;
+  wxCheckBox* m_framedOutput;
+  wxCheckBox* m_useStdio;
+  wxCheckBox* m_warmStandby;
+  wxCheckBox* m_cacheResults;
+  wxCheckBox* m_saveSession;
+  wxSpinCtrl* m_pipelineDepth;
+  wxSpinCtrl* m_kernelCount;
+  wxSpinCtrl* m_outputLinesLimit;
+  wxSpinCtrl* m_outputSizeLimit;
   wxComboBox* m_language;
   wxCheckBox* m_saveSize;
   wxCheckBox* m_savePanes;
@@ -108,6 +118,9 @@ protected:
   wxCheckBox* m_enterEvaluates;
   wxCheckBox* m_saveUntitled;
   wxCheckBox* m_openHCaret;
+  wxCheckBox* m_singleInstance;
+  wxCheckBox* m_anyPort;
+  wxCheckBox* m_virtualLayout;
   wxButton* m_getFont;
   wxButton* m_getStyleFont;
   wxFontEncoding m_fontEncoding;
@@ -0,0 +1,170 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#include "DeferredCell.h"
+#include "MathParser.h"
+
+#include <wx/mstream.h>
+#include <wx/zstream.h>
+
+#include <string.h>
+
+#define PREVIEW_LENGTH 80
+
+DeferredCell::DeferredCell(wxString xml, int style) : TextCell()
+{
+  m_style = style;
+
+  wxMemoryOutputStream compressed;
+  {
+    wxZlibOutputStream zlib(compressed);
+    const wxCharBuffer data = xml.mb_str(wxConvUTF8);
+    zlib.Write(data.data(), strlen(data.data()));
+    zlib.Close();
+  }
+
+  size_t size = compressed.GetSize();
+  compressed.CopyTo(m_data.GetWriteBuf(size), size);
+  m_data.UngetWriteBuf(size);
+
+  SetValue(wxString::Format(_(" << Expression too long to display (%lu characters), double click to show: %s... >>"),
+                            (unsigned long)xml.Length(), Preview(xml).c_str()));
+}
+
+DeferredCell::~DeferredCell()
+{
+}
+
+MathCell* DeferredCell::Copy(bool all)
+{
+  DeferredCell *tmp = new DeferredCell();
+  CopyData(this, tmp);
+  tmp->m_text = wxString(m_text);
+  tmp->m_data = m_data; // the data is shared, it never changes
+  tmp->m_style = m_style;
+  tmp->m_forceBreakLine = m_forceBreakLine;
+  tmp->m_bigSkip = m_bigSkip;
+  tmp->m_isHidden = m_isHidden;
+  tmp->m_textStyle = m_textStyle;
+  tmp->m_highlight = m_highlight;
+  if (all && m_next != NULL)
+    tmp->AppendCell(m_next->Copy(all));
+  return tmp;
+}
+
+wxString DeferredCell::GetXML()
+{
+  wxMemoryInputStream compressed(m_data.GetData(), m_data.GetDataLen());
+  wxZlibInputStream zlib(compressed);
+
+  wxMemoryBuffer data;
+  char buffer[4096];
+  while (!zlib.Eof())
+  {
+    zlib.Read(buffer, sizeof(buffer));
+    size_t read = zlib.LastRead();
+    if (read == 0)
+      break;
+    data.AppendData(buffer, read);
+  }
+
+  return wxString((const char *)data.GetData(), wxConvUTF8, data.GetDataLen());
+}
+
+static void DestroyCells(MathCell *cells)
+{
+  while (cells != NULL)
+  {
+    MathCell *tmp = cells;
+    cells = cells->m_next;
+    tmp->Destroy();
+    delete tmp;
+  }
+}
+
+MathCell* DeferredCell::Expand()
+{
+  MathParser parser;
+  return parser.ParseLine(GetXML(), m_style, true);
+}
+
+/***
+ * The text at the beginning of the expression, without tags.
+ */
+wxString DeferredCell::Preview(wxString xml)
+{
+  wxString preview;
+  bool inTag = false;
+
+  for (size_t i = 0; i < xml.Length() && preview.Length() < PREVIEW_LENGTH; i++)
+  {
+    if (xml[i] == wxT('<'))
+      inTag = true;
+    else if (xml[i] == wxT('>'))
+      inTag = false;
+    else if (!inTag)
+      preview += xml[i];
+  }
+
+  preview.Replace(wxT("&lt;"), wxT("<"));
+  preview.Replace(wxT("&gt;"), wxT(">"));
+  preview.Replace(wxT("&amp;"), wxT("&"));
+
+  return preview;
+}
+
+wxString DeferredCell::ToString(bool all)
+{
+  wxString s;
+  MathCell *cells = Expand();
+  if (cells != NULL)
+  {
+    s = cells->ToString(true);
+    DestroyCells(cells);
+  }
+  return s + MathCell::ToString(all);
+}
+
+wxString DeferredCell::ToTeX(bool all)
+{
+  wxString s;
+  MathCell *cells = Expand();
+  if (cells != NULL)
+  {
+    s = cells->ToTeX(true);
+    DestroyCells(cells);
+  }
+  return s + MathCell::ToTeX(all);
+}
+
+/***
+ * Saves the xml from maxima as the text of a <deferred> tag. The parser
+ * turns the tag back into a DeferredCell, so the expression is not parsed
+ * again when the document is opened.
+ */
+wxString DeferredCell::ToXML(bool all)
+{
+  wxString xml = GetXML();
+
+  xml.Replace(wxT("&"), wxT("&amp;"));
+  xml.Replace(wxT("<"), wxT("&lt;"));
+  xml.Replace(wxT(">"), wxT("&gt;"));
+
+  return wxT("<deferred>") + xml + wxT("</deferred>") + MathCell::ToXML(all);
+}
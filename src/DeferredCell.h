@@ -0,0 +1,47 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#ifndef _DEFERREDCELL_H_
+#define _DEFERREDCELL_H_
+
+#include "TextCell.h"
+
+// Stands for an expression which is too long to be displayed. The xml
+// from maxima is kept compressed and the cell only shows its size and
+// the beginning of the text. Expand parses the whole expression.
+class DeferredCell : public TextCell
+{
+public:
+  DeferredCell(wxString xml, int style);
+  ~DeferredCell();
+  MathCell* Copy(bool all);
+  // Parses the expression. Returns NULL if the xml is not valid.
+  MathCell* Expand();
+  wxString GetXML();
+  wxString ToString(bool all);
+  wxString ToTeX(bool all);
+  wxString ToXML(bool all);
+protected:
+  DeferredCell() : TextCell() { }
+  static wxString Preview(wxString xml);
+  wxMemoryBuffer m_data;
+  int m_style;
+};
+
+#endif //_DEFERREDCELL_H_
@@ -0,0 +1,180 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#include "DependencyGraph.h"
+#include "EditorCell.h"
+
+#include <wx/tokenzr.h>
+
+DependencyGraph::DependencyGraph()
+{
+  // The same expressions wxMaxima uses to find definitions for autocompletion
+  m_funRegEx.Compile(wxT("^ *([[:alnum:]%_]+) *\\(([[:alnum:]%_,[[.].] ]*)\\) *:="));
+  m_varRegEx.Compile(wxT("^ *([[:alnum:]%_]+) *:"));
+  m_stamp = 0;
+}
+
+void DependencyGraph::Clear()
+{
+  m_evaluations.clear();
+}
+
+/***
+ * The input of the cell with the ending which is added when it is
+ * evaluated.
+ */
+wxString DependencyGraph::GetInput(GroupCell *group)
+{
+  wxString input = group->GetEditable()->GetValue();
+  input.Trim();
+  if (!input.StartsWith(wxT(":lisp")) &&
+      !input.EndsWith(wxT(";")) && !input.EndsWith(wxT("$")))
+    input += wxT(";");
+  return input;
+}
+
+void DependencyGraph::Evaluated(GroupCell *group)
+{
+  if (group == NULL || group->GetEditable() == NULL)
+    return;
+
+  CellEvaluation evaluation;
+  evaluation.input = GetInput(group);
+  evaluation.stamp = ++m_stamp;
+  m_evaluations[group] = evaluation;
+}
+
+/***
+ * Finds the symbols the input defines and the symbols it uses. Strings
+ * and comments are skipped.
+ */
+void DependencyGraph::ParseInput(wxString input, wxArrayString &defines,
+                                 wxArrayString &uses, bool *barrier)
+{
+  wxString code;
+  size_t i = 0;
+  while (i < input.Length())
+  {
+    if (input[i] == wxT('"')) {
+      i++;
+      while (i < input.Length() && input[i] != wxT('"')) {
+        if (input[i] == wxT('\\'))
+          i++;
+        i++;
+      }
+      i++;
+      code += wxT(" ");
+    }
+    else if (input.Mid(i, 2) == wxT("/*")) {
+      int end = input.Mid(i + 2).Find(wxT("*/"));
+      i = (end == -1) ? input.Length() : i + end + 4;
+      code += wxT(" ");
+    }
+    else
+      code += input[i++];
+  }
+
+  // The regexes are anchored at the start of a command, like in
+  // wxMaxima::SendMaxima the commands are on one line
+  code.Replace(wxT("\n"), wxT(" "));
+  code.Replace(wxT("\r"), wxT(" "));
+  code.Replace(wxT("\t"), wxT(" "));
+
+  wxStringTokenizer commands(code, wxT(";$"));
+  while (commands.HasMoreTokens())
+  {
+    wxString line = commands.GetNextToken();
+    if (m_funRegEx.Matches(line))
+      defines.Add(m_funRegEx.GetMatch(line, 1));
+    else if (m_varRegEx.Matches(line))
+      defines.Add(m_varRegEx.GetMatch(line, 1));
+  }
+
+  *barrier = false;
+  wxString symbol;
+  for (i = 0; i <= code.Length(); i++)
+  {
+    if (i < code.Length() && (wxIsalnum(code[i]) || code[i] == wxT('%') || code[i] == wxT('_')))
+      symbol += code[i];
+    else if (symbol.Length() > 0)
+    {
+      if (!wxIsdigit(symbol[0]))
+      {
+        if (symbol == wxT("kill") || symbol == wxT("load") || symbol == wxT("batch") ||
+            symbol == wxT("batchload") || symbol == wxT("remvalue") ||
+            symbol == wxT("remfunction") || symbol == wxT("reset"))
+          *barrier = true;
+        uses.Add(symbol);
+      }
+      symbol = wxEmptyString;
+    }
+  }
+}
+
+std::vector<GroupCell*> DependencyGraph::GetStaleCells(GroupCell *tree)
+{
+  std::vector<GroupCell*> stale;
+  SymbolDefinitions definitions;
+  SymbolDefinition barrier;
+  bool haveBarrier = false;
+
+  for (; tree != NULL; tree = dynamic_cast<GroupCell*>(tree->m_next))
+  {
+    if (tree->GetGroupType() != GC_TYPE_CODE || tree->GetEditable() == NULL)
+      continue;
+
+    wxString input = GetInput(tree);
+    if (input == wxT(";"))
+      continue;
+
+    wxArrayString defines, uses;
+    bool isBarrier;
+    ParseInput(input, defines, uses, &isBarrier);
+
+    CellEvaluations::iterator evaluation = m_evaluations.find(tree);
+    bool isStale = (evaluation == m_evaluations.end() ||
+                    evaluation->second.input != input);
+    long stamp = isStale ? m_stamp + 1 : evaluation->second.stamp;
+
+    if (!isStale && haveBarrier)
+      isStale = barrier.stale || barrier.stamp > stamp;
+
+    for (unsigned int i = 0; i < uses.GetCount() && !isStale; i++)
+    {
+      SymbolDefinitions::iterator definition = definitions.find(uses[i]);
+      if (definition != definitions.end())
+        isStale = definition->second.stale || definition->second.stamp > stamp;
+    }
+
+    SymbolDefinition definition;
+    definition.stale = isStale;
+    definition.stamp = stamp;
+    for (unsigned int i = 0; i < defines.GetCount(); i++)
+      definitions[defines[i]] = definition;
+    if (isBarrier) {
+      barrier = definition;
+      haveBarrier = true;
+    }
+
+    if (isStale)
+      stale.push_back(tree);
+  }
+
+  return stale;
+}
@@ -0,0 +1,73 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#ifndef _DEPENDENCYGRAPH_H_
+#define _DEPENDENCYGRAPH_H_
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <wx/regex.h>
+#include <wx/hashmap.h>
+
+#include <vector>
+
+#include "GroupCell.h"
+
+struct CellEvaluation
+{
+  wxString input;
+  long stamp;
+};
+WX_DECLARE_VOIDPTR_HASH_MAP(CellEvaluation, CellEvaluations);
+
+struct SymbolDefinition
+{
+  bool stale;
+  long stamp;
+};
+WX_DECLARE_STRING_HASH_MAP(SymbolDefinition, SymbolDefinitions);
+
+// Which code cells define which symbols and which cells use them.
+//
+// Evaluated records the input of a cell when maxima has evaluated it.
+// A cell is stale if it was not evaluated since maxima was started, if
+// its input changed since then, or if a cell above it which defines a
+// symbol it uses is stale or was evaluated after it. Cells which call
+// functions like kill or load can change anything, so all cells below
+// them depend on them.
+class DependencyGraph
+{
+public:
+  DependencyGraph();
+  // Maxima was restarted, nothing is evaluated.
+  void Clear();
+  void Evaluated(GroupCell *group);
+  // The stale code cells of the document, in document order.
+  std::vector<GroupCell*> GetStaleCells(GroupCell *tree);
+private:
+  static wxString GetInput(GroupCell *group);
+  void ParseInput(wxString input, wxArrayString &defines, wxArrayString &uses,
+                  bool *barrier);
+  CellEvaluations m_evaluations;
+  long m_stamp;
+  wxRegEx m_funRegEx;
+  wxRegEx m_varRegEx;
+};
+
+#endif // _DEPENDENCYGRAPH_H_
@@ -21,6 +21,7 @@
 #include <wx/regex.h>
 
 #include "EditorCell.h"
+#include "TextExtentCache.h"
 #include "wxMaxima.h"
 #include "wxMaximaFrame.h"
 
@@ -137,7 +138,7 @@ void EditorCell::RecalculateWidths(CellParser& parser, int fontsize, bool all)
     double scale = parser.GetScale();
     SetFont(parser, fontsize);
 
-    dc.GetTextExtent(wxT("X"), &m_charWidth, &m_charHeight);
+    TextExtentCache::GetTextExtent(dc, wxT("X"), &m_charWidth, &m_charHeight);
 
     unsigned int newLinePos = 0, prevNewLinePos = 0;
     int width = 0, width1, height1;
@@ -153,7 +154,7 @@ void EditorCell::RecalculateWidths(CellParser& parser, int fontsize, bool all)
         newLinePos++;
       }
 
-      dc.GetTextExtent(m_text.SubString(prevNewLinePos, newLinePos), &width1, &height1);
+      TextExtentCache::GetTextExtent(dc, m_text.SubString(prevNewLinePos, newLinePos), &width1, &height1);
       width = MAX(width, width1);
 
       while (newLinePos < m_text.Length() && m_text.GetChar(newLinePos) == '\n')
@@ -391,12 +392,12 @@ void EditorCell::SetFont(CellParser& parser, int fontsize)
   m_underlined = parser.IsUnderlined(m_textStyle);
   m_fontEncoding = parser.GetFontEncoding();
 
-  dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                    m_fontStyle,
-                    m_fontWeight,
-                    m_underlined,
-                    m_fontName,
-                    m_fontEncoding));
+  dc.SetFont(CellParser::GetFont(fontsize1,
+                                 m_fontStyle,
+                                 m_fontWeight,
+                                 m_underlined,
+                                 m_fontName,
+                                 m_fontEncoding));
 }
 
 void EditorCell::SetForeground(CellParser& parser)
@@ -1394,12 +1395,12 @@ void EditorCell::SelectPointText(wxDC& dc, wxPoint& point)
   wxString s;
   int fontsize1 = m_fontSize;
 
-  dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                    m_fontStyle,
-                    m_fontWeight,
-                    m_underlined,
-                    m_fontName,
-                    m_fontEncoding));
+  dc.SetFont(CellParser::GetFont(fontsize1,
+                                 m_fontStyle,
+                                 m_fontWeight,
+                                 m_underlined,
+                                 m_fontName,
+                                 m_fontEncoding));
 
   m_selectionEnd = m_selectionStart = -1;
   wxPoint translate(point);
@@ -1462,12 +1463,12 @@ bool EditorCell::IsPointInSelection(wxDC& dc, wxPoint point)
   wxString s;
   int fontsize1 = m_fontSize;
 
-  dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                    m_fontStyle,
-                    m_fontWeight,
-                    m_underlined,
-                    m_fontName,
-                    m_fontEncoding));
+  dc.SetFont(CellParser::GetFont(fontsize1,
+                                 m_fontStyle,
+                                 m_fontWeight,
+                                 m_underlined,
+                                 m_fontName,
+                                 m_fontEncoding));
   wxPoint translate(point);
   translate.x -= m_currentPoint.x - 2;
   translate.y -= m_currentPoint.y - 2 - m_center;
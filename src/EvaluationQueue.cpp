@@ -17,11 +17,14 @@
 ///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 ///
 
+
 #include "EvaluationQueue.h"
 
-EvaluationQueueElement::EvaluationQueueElement(GroupCell* gr)
+EvaluationQueueElement::EvaluationQueueElement(GroupCell* gr, int prio)
 {
   group = gr;
+  priority = prio;
+  previous = NULL;
   next = NULL;
 }
 
@@ -29,31 +32,20 @@ EvaluationQueue::EvaluationQueue()
 {
   m_queue = NULL;
   m_last = NULL;
+  m_size = 0;
+  m_pinned = 0;
 }
 
-bool EvaluationQueue::IsInQueue(GroupCell* gr)
-{
-  EvaluationQueueElement* tmp = m_queue;
-  while (tmp != NULL) {
-    if (tmp->group == gr)
-      return true;
-    tmp = tmp->next;
-  }
-  return false;
-}
-
-void EvaluationQueue::AddToQueue(GroupCell* gr)
+void EvaluationQueue::AddToQueue(GroupCell* gr, int priority)
 {
   if (gr->GetGroupType() != GC_TYPE_CODE
       || gr->GetEditable() == NULL) // dont add cells which can't be evaluated
     return;
-  EvaluationQueueElement* newelement = new EvaluationQueueElement(gr);
-  if (m_last == NULL)
-    m_queue = m_last = newelement;
-  else {
-    m_last->next = newelement;
-    m_last = newelement;
-  }
+  if (IsInQueue(gr))
+    return;
+  EvaluationQueueElement* newelement = new EvaluationQueueElement(gr, priority);
+  InsertByPriority(newelement);
+  m_index[gr] = newelement;
 }
 
 void EvaluationQueue::RemoveFirst()
@@ -61,13 +53,140 @@ void EvaluationQueue::RemoveFirst()
   if (m_queue == NULL)
     return; // shouldn't happen
   EvaluationQueueElement* tmp = m_queue;
-  if (m_queue == m_last) {
-    m_queue = m_last = NULL;
+  if (m_pinned > 0)
+    m_pinned--;
+  Unlink(tmp);
+  m_index.erase(tmp->group);
+  delete tmp;
+}
+
+/***
+ * Removes a cell which is not pinned from the queue.
+ */
+bool EvaluationQueue::Remove(GroupCell* gr)
+{
+  EvaluationQueueIndex::iterator it = m_index.find(gr);
+  if (it == m_index.end())
+    return false;
+
+  EvaluationQueueElement* element = it->second;
+  if (IsPinned(element))
+    return false;
+
+  Unlink(element);
+  m_index.erase(it);
+  delete element;
+  return true;
+}
+
+/***
+ * Moves gr to the position index, but not before the pinned cells. It
+ * takes the priority of the cell it is moved in front of.
+ */
+bool EvaluationQueue::Move(GroupCell* gr, int index)
+{
+  EvaluationQueueIndex::iterator it = m_index.find(gr);
+  if (it == m_index.end() || IsPinned(it->second))
+    return false;
+
+  if (index < m_pinned)
+    index = m_pinned;
+
+  EvaluationQueueElement* element = it->second;
+  Unlink(element);
+
+  EvaluationQueueElement* before = ElementAt(index);
+  if (before != NULL)
+    element->priority = before->priority;
+  else if (m_last != NULL && m_last->priority < element->priority)
+    element->priority = m_last->priority;
+  InsertBefore(element, before);
+
+  return true;
+}
+
+bool EvaluationQueue::SetPriority(GroupCell* gr, int priority)
+{
+  EvaluationQueueIndex::iterator it = m_index.find(gr);
+  if (it == m_index.end() || IsPinned(it->second))
+    return false;
+
+  EvaluationQueueElement* element = it->second;
+  Unlink(element);
+  element->priority = priority;
+  InsertByPriority(element);
+  return true;
+}
+
+int EvaluationQueue::GetPriority(GroupCell* gr)
+{
+  EvaluationQueueIndex::iterator it = m_index.find(gr);
+  if (it == m_index.end())
+    return 0;
+  return it->second->priority;
+}
+
+void EvaluationQueue::Pin(int count)
+{
+  m_pinned = count;
+  if (m_pinned > m_size)
+    m_pinned = m_size;
+  if (m_pinned < 0)
+    m_pinned = 0;
+}
+
+void EvaluationQueue::Clear()
+{
+  while (m_queue != NULL)
+  {
+    EvaluationQueueElement* tmp = m_queue;
+    m_queue = m_queue->next;
+    delete tmp;
   }
+  m_last = NULL;
+  m_index.clear();
+  m_size = 0;
+  m_pinned = 0;
+}
+
+bool EvaluationQueue::IsPinned(EvaluationQueueElement* element)
+{
+  EvaluationQueueElement* tmp = m_queue;
+  for (int i = 0; i < m_pinned && tmp != NULL; i++, tmp = tmp->next)
+    if (tmp == element)
+      return true;
+  return false;
+}
+
+EvaluationQueueElement* EvaluationQueue::ElementAt(int index)
+{
+  EvaluationQueueElement* tmp = m_queue;
+  while (tmp != NULL && index > 0) {
+    tmp = tmp->next;
+    index--;
+  }
+  return tmp;
+}
+
+GroupCell* EvaluationQueue::GetAt(int index)
+{
+  EvaluationQueueElement* tmp = ElementAt(index);
+  if (tmp != NULL)
+    return tmp->group;
   else
-    m_queue = m_queue->next;
+    return NULL;
+}
 
-  delete tmp;
+int EvaluationQueue::GetIndex(GroupCell* gr)
+{
+  EvaluationQueueIndex::iterator it = m_index.find(gr);
+  if (it == m_index.end())
+    return -1;
+
+  int index = 0;
+  for (EvaluationQueueElement* tmp = it->second->previous; tmp != NULL; tmp = tmp->previous)
+    index++;
+  return index;
 }
 
 GroupCell* EvaluationQueue::GetFirst()
@@ -77,3 +196,65 @@ GroupCell* EvaluationQueue::GetFirst()
   else
     return NULL; // queu is empty
 }
+
+void EvaluationQueue::Unlink(EvaluationQueueElement* element)
+{
+  if (element->previous != NULL)
+    element->previous->next = element->next;
+  else
+    m_queue = element->next;
+
+  if (element->next != NULL)
+    element->next->previous = element->previous;
+  else
+    m_last = element->previous;
+
+  element->previous = element->next = NULL;
+  m_size--;
+}
+
+/***
+ * Links element in front of before, or at the end if before is NULL.
+ */
+void EvaluationQueue::InsertBefore(EvaluationQueueElement* element,
+                                   EvaluationQueueElement* before)
+{
+  element->next = before;
+  if (before == NULL) {
+    element->previous = m_last;
+    if (m_last != NULL)
+      m_last->next = element;
+    else
+      m_queue = element;
+    m_last = element;
+  }
+  else {
+    element->previous = before->previous;
+    if (before->previous != NULL)
+      before->previous->next = element;
+    else
+      m_queue = element;
+    before->previous = element;
+  }
+  m_size++;
+}
+
+/***
+ * Links element behind the last cell with the same or a higher
+ * priority, but not in front of the pinned cells. Cells are usually
+ * added with the same priority, then this is constant time.
+ */
+void EvaluationQueue::InsertByPriority(EvaluationQueueElement* element)
+{
+  EvaluationQueueElement* before = NULL;
+  EvaluationQueueElement* tmp = m_last;
+  int index = m_size - 1;
+
+  while (tmp != NULL && index >= m_pinned && tmp->priority < element->priority) {
+    before = tmp;
+    tmp = tmp->previous;
+    index--;
+  }
+
+  InsertBefore(element, before);
+}
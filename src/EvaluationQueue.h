@@ -21,33 +21,65 @@
 #ifndef EVALUATIONQUEUE_H_
 #define EVALUATIONQUEUE_H_
 
+#include <wx/hashmap.h>
+
 #include "GroupCell.h"
 
 class EvaluationQueueElement {
   public:
-    EvaluationQueueElement(GroupCell* gr);
+    EvaluationQueueElement(GroupCell* gr, int prio);
     ~EvaluationQueueElement() {
     }
     GroupCell* group;
+    int priority;
+    EvaluationQueueElement* previous;
     EvaluationQueueElement* next;
 };
 
-// A simple FIFO queue with manual removal of elements
+WX_DECLARE_VOIDPTR_HASH_MAP(EvaluationQueueElement*, EvaluationQueueIndex);
+
+// The cells waiting for evaluation. A doubly linked list ordered by
+// priority, first in first out among cells with the same priority,
+// with an index from the cells to their elements, so that finding and
+// removing a cell doesn't walk the list. Move, GetAt and GetIndex walk
+// the list up to the index. A cell is in the queue at most once.
+//
+// The first cells of the queue can be pinned: they were already sent
+// to maxima, so nothing is moved or added before them.
 class EvaluationQueue
 {
   public:
     EvaluationQueue();
-    ~EvaluationQueue() {};
+    ~EvaluationQueue() { Clear(); }
 
-    bool IsInQueue(GroupCell* gr);
+    bool IsInQueue(GroupCell* gr) { return m_index.find(gr) != m_index.end(); }
 
-    void AddToQueue(GroupCell* gr);
+    void AddToQueue(GroupCell* gr, int priority = 0);
     void RemoveFirst();
+    bool Remove(GroupCell* gr);
+    bool Move(GroupCell* gr, int index);    // moves gr to the position index
+    bool MoveToFront(GroupCell* gr) { return Move(gr, 0); }
+    bool SetPriority(GroupCell* gr, int priority);
+    int GetPriority(GroupCell* gr);
+    void Pin(int count);                    // pins the first count cells
+    int GetPinned() { return m_pinned; }
+    void Clear();
     GroupCell* GetFirst();
+    GroupCell* GetAt(int index);
+    int GetIndex(GroupCell* gr);            // -1 if gr is not in the queue
+    int Size() { return m_size; }
     bool Empty() { return m_queue == NULL; }
   private:
+    EvaluationQueueElement* ElementAt(int index);
+    bool IsPinned(EvaluationQueueElement* element);
+    void Unlink(EvaluationQueueElement* element);
+    void InsertBefore(EvaluationQueueElement* element, EvaluationQueueElement* before);
+    void InsertByPriority(EvaluationQueueElement* element);
     EvaluationQueueElement* m_queue;
     EvaluationQueueElement* m_last;
+    EvaluationQueueIndex m_index;
+    int m_size;
+    int m_pinned;
 };
 
 
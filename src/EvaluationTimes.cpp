@@ -0,0 +1,232 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+
+#include "EvaluationTimes.h"
+
+#include <algorithm>
+
+EvaluationTimes::EvaluationTimes(wxWindow* parent, int id, const wxString& title,
+                                 GroupCell *tree, const wxString& statistics,
+                                 const wxPoint& pos, const wxSize& size, long style):
+    wxDialog(parent, id, title, pos, size, style)
+{
+  int number = 0;
+  for (GroupCell *tmp = tree; tmp != NULL; tmp = dynamic_cast<GroupCell*>(tmp->m_next))
+  {
+    if (tmp->GetGroupType() != GC_TYPE_CODE)
+      continue;
+    number++;
+    if (tmp->GetEvaluationTime() >= 0) {
+      m_cells.push_back(tmp);
+      m_numbers.push_back(number);
+    }
+  }
+
+  m_sortColumn = COLUMN_TOTAL;
+  m_ascending = false;
+
+  list_ctrl_1 = new wxListCtrl(this, evaluation_times_list, wxDefaultPosition,
+                               wxSize(600, 350), wxLC_REPORT | wxLC_SINGLE_SEL);
+  label_1 = new wxStaticText(this, -1, statistics);
+  static_line_1 = new wxStaticLine(this, -1);
+
+#if defined __WXMSW__
+  button_1 = new wxButton(this, wxID_OK, _("Go to Cell"));
+  button_2 = new wxButton(this, wxID_CANCEL, _("Close"));
+#else
+  button_1 = new wxButton(this, wxID_CANCEL, _("Close"));
+  button_2 = new wxButton(this, wxID_OK, _("Go to Cell"));
+#endif
+
+  set_properties();
+  do_layout();
+  Sort();
+}
+
+void EvaluationTimes::set_properties()
+{
+  list_ctrl_1->InsertColumn(COLUMN_CELL, _("Cell"), wxLIST_FORMAT_RIGHT, 50);
+  list_ctrl_1->InsertColumn(COLUMN_INPUT, _("Input"), wxLIST_FORMAT_LEFT, 230);
+  list_ctrl_1->InsertColumn(COLUMN_TOTAL, _("Total"), wxLIST_FORMAT_RIGHT, 80);
+  list_ctrl_1->InsertColumn(COLUMN_MAXIMA, _("Maxima"), wxLIST_FORMAT_RIGHT, 80);
+  list_ctrl_1->InsertColumn(COLUMN_PARSING, _("Parsing"), wxLIST_FORMAT_RIGHT, 80);
+  list_ctrl_1->InsertColumn(COLUMN_LAYOUT, _("Layout"), wxLIST_FORMAT_RIGHT, 80);
+
+#if defined __WXMSW__
+  button_1->SetDefault();
+#else
+  button_2->SetDefault();
+#endif
+}
+
+void EvaluationTimes::do_layout()
+{
+  wxFlexGridSizer* grid_sizer_1 = new wxFlexGridSizer(4, 1, 0, 0);
+  wxBoxSizer* sizer_1 = new wxBoxSizer(wxHORIZONTAL);
+  grid_sizer_1->Add(list_ctrl_1, 1, wxALL | wxEXPAND, 5);
+  grid_sizer_1->Add(label_1, 0, wxALL, 5);
+  grid_sizer_1->Add(static_line_1, 0, wxEXPAND | wxLEFT | wxRIGHT, 2);
+  sizer_1->Add(button_1, 0, wxALL, 5);
+  sizer_1->Add(button_2, 0, wxALL, 5);
+  grid_sizer_1->Add(sizer_1, 1, wxALIGN_RIGHT, 0);
+  grid_sizer_1->AddGrowableRow(0);
+  grid_sizer_1->AddGrowableCol(0);
+  SetAutoLayout(true);
+  SetSizer(grid_sizer_1);
+  grid_sizer_1->Fit(this);
+  grid_sizer_1->SetSizeHints(this);
+  Layout();
+}
+
+/***
+ * The value by which the rows are sorted. The time spent in a stage is
+ * the difference to the stage before it.
+ */
+long EvaluationTimes::GetValue(GroupCell *cell, int column)
+{
+  switch (column)
+  {
+  case COLUMN_TOTAL:
+    return cell->GetEvaluationTime();
+  case COLUMN_MAXIMA:
+    return cell->GetTime(GC_TIME_PROMPT);
+  case COLUMN_PARSING:
+    if (cell->GetTime(GC_TIME_PARSED) < 0)
+      return -1;
+    return cell->GetTime(GC_TIME_PARSED) - cell->GetTime(GC_TIME_PROMPT);
+  case COLUMN_LAYOUT:
+    if (cell->GetTime(GC_TIME_LAYOUT) < 0)
+      return -1;
+    return cell->GetTime(GC_TIME_LAYOUT) - cell->GetTime(GC_TIME_PARSED);
+  default:
+    return 0;
+  }
+}
+
+wxString EvaluationTimes::FormatTime(long time)
+{
+  if (time < 0)
+    return wxT("-");
+  return wxString::Format(wxT("%.3f s"), time / 1000.0);
+}
+
+// Orders row indices by the value in one column
+class EvaluationTimesOrder
+{
+public:
+  EvaluationTimesOrder(std::vector<long>& values, bool ascending) :
+    m_values(values), m_ascending(ascending) {}
+  bool operator()(int a, int b)
+  {
+    if (m_ascending)
+      return m_values[a] < m_values[b];
+    return m_values[a] > m_values[b];
+  }
+private:
+  std::vector<long>& m_values;
+  bool m_ascending;
+};
+
+void EvaluationTimes::Sort()
+{
+  std::vector<long> values;
+  std::vector<int> order;
+  for (unsigned int i = 0; i < m_cells.size(); i++)
+  {
+    if (m_sortColumn == COLUMN_CELL || m_sortColumn == COLUMN_INPUT)
+      values.push_back(m_numbers[i]);
+    else
+      values.push_back(GetValue(m_cells[i], m_sortColumn));
+    order.push_back(i);
+  }
+
+  std::stable_sort(order.begin(), order.end(),
+                   EvaluationTimesOrder(values, m_ascending));
+
+  std::vector<GroupCell*> cells;
+  std::vector<int> numbers;
+  for (unsigned int i = 0; i < order.size(); i++)
+  {
+    cells.push_back(m_cells[order[i]]);
+    numbers.push_back(m_numbers[order[i]]);
+  }
+  m_cells = cells;
+  m_numbers = numbers;
+
+  Fill();
+}
+
+void EvaluationTimes::Fill()
+{
+  list_ctrl_1->DeleteAllItems();
+
+  for (unsigned int i = 0; i < m_cells.size(); i++)
+  {
+    GroupCell *cell = m_cells[i];
+
+    wxString input = cell->GetEditable()->GetValue();
+    input = input.BeforeFirst(wxT('\n'));
+    if (input.Length() > 60)
+      input = input.Left(60) + wxT("...");
+
+    long item = list_ctrl_1->InsertItem(i, wxString::Format(wxT("%d"), m_numbers[i]));
+    list_ctrl_1->SetItem(item, COLUMN_INPUT, input);
+    for (int column = COLUMN_TOTAL; column <= COLUMN_LAYOUT; column++)
+      list_ctrl_1->SetItem(item, column, FormatTime(GetValue(cell, column)));
+  }
+
+  if (!m_cells.empty())
+    list_ctrl_1->SetItemState(0, wxLIST_STATE_SELECTED, wxLIST_STATE_SELECTED);
+}
+
+GroupCell* EvaluationTimes::GetSelection()
+{
+  long item = list_ctrl_1->GetNextItem(-1, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED);
+  if (item < 0 || item >= (long)m_cells.size())
+    return NULL;
+  return m_cells[item];
+}
+
+void EvaluationTimes::OnColumnClick(wxListEvent& event)
+{
+  int column = event.GetColumn();
+  if (column < 0)
+    return;
+
+  // Times are sorted slowest first, a second click reverses the order
+  if (column == m_sortColumn)
+    m_ascending = !m_ascending;
+  else {
+    m_sortColumn = column;
+    m_ascending = (column == COLUMN_CELL || column == COLUMN_INPUT);
+  }
+
+  Sort();
+}
+
+void EvaluationTimes::OnActivated(wxListEvent& event)
+{
+  EndModal(wxID_OK);
+}
+
+BEGIN_EVENT_TABLE(EvaluationTimes, wxDialog)
+  EVT_LIST_COL_CLICK(evaluation_times_list, EvaluationTimes::OnColumnClick)
+  EVT_LIST_ITEM_ACTIVATED(evaluation_times_list, EvaluationTimes::OnActivated)
+END_EVENT_TABLE()
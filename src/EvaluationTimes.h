@@ -0,0 +1,79 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+
+#ifndef EVALUATIONTIMES_H
+#define EVALUATIONTIMES_H
+
+#include <wx/wx.h>
+#include <wx/listctrl.h>
+#include <wx/statline.h>
+
+#include <vector>
+
+#include "GroupCell.h"
+
+enum {
+  evaluation_times_list
+};
+
+// Lists the code cells of the document which were evaluated, slowest
+// first. Clicking a column header sorts by that column. GetSelection
+// returns the cell which was chosen when the dialog was closed with OK.
+// statistics is shown below the list, e.g. how the output was laid out.
+class EvaluationTimes: public wxDialog
+{
+public:
+  EvaluationTimes(wxWindow* parent, int id, const wxString& title,
+                  GroupCell *tree, const wxString& statistics,
+                  const wxPoint& pos = wxDefaultPosition,
+                  const wxSize& size = wxDefaultSize,
+                  long style = wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER);
+  GroupCell* GetSelection();
+  bool IsEmpty() { return m_cells.empty(); }
+private:
+  enum {
+    COLUMN_CELL,
+    COLUMN_INPUT,
+    COLUMN_TOTAL,
+    COLUMN_MAXIMA,
+    COLUMN_PARSING,
+    COLUMN_LAYOUT
+  };
+  static long GetValue(GroupCell *cell, int column);
+  static wxString FormatTime(long time);
+  void Sort();
+  void Fill();
+  void OnColumnClick(wxListEvent& event);
+  void OnActivated(wxListEvent& event);
+  void set_properties();
+  void do_layout();
+  std::vector<GroupCell*> m_cells;
+  std::vector<int> m_numbers;
+  int m_sortColumn;
+  bool m_ascending;
+  wxListCtrl* list_ctrl_1;
+  wxStaticText* label_1;
+  wxStaticLine* static_line_1;
+  wxButton* button_1;
+  wxButton* button_2;
+  DECLARE_EVENT_TABLE()
+};
+
+#endif // EVALUATIONTIMES_H
@@ -131,9 +131,9 @@ void FracCell::RecalculateWidths(CellParser& parser, int fontsize, bool all)
     wxDC& dc = parser.GetDC();
     int height;
     int fontsize1 = (int) ((double)(fontsize) * scale + 0.5);
-    dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                            false, false, false,
-                            parser.GetFontName(TS_VARIABLE)));
+    dc.SetFont(CellParser::GetFont(fontsize1,
+                                         false, false, false,
+                                         parser.GetFontName(TS_VARIABLE)));
     dc.GetTextExtent(wxT("/"), &m_expDivideWidth, &height);
     m_width = m_num->GetFullWidth(scale) + m_denom->GetFullWidth(scale) + m_expDivideWidth;
   }
@@ -203,9 +203,9 @@ void FracCell::Draw(CellParser& parser, wxPoint point, int fontsize, bool all)
       m_denom->Draw(parser, denom, fontsize, true);
 
       int fontsize1 = (int) ((double)(fontsize) * scale + 0.5);
-      dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                              false, false, false,
-                              parser.GetFontName(TS_VARIABLE)));
+      dc.SetFont(CellParser::GetFont(fontsize1,
+                                           false, false, false,
+                                           parser.GetFontName(TS_VARIABLE)));
       dc.DrawText(wxT("/"),
                   point.x + m_num->GetFullWidth(scale),
                   point.y - m_num->GetMaxCenter() + SCALE_PX(MC_TEXT_PADDING, scale));
@@ -20,6 +20,9 @@
 
 #include <wx/config.h>
 #include <wx/clipbrd.h>
+#include <wx/tokenzr.h>
+
+#include <math.h>
 
 #include "GroupCell.h"
 #include "TextCell.h"
@@ -27,6 +30,9 @@
 #include "ImgCell.h"
 #include "Bitmap.h"
 
+// Height assumed for a plot or an image which was not laid out yet
+#define GC_ESTIMATED_IMAGE_HEIGHT 300
+
 GroupCell::GroupCell(int groupType, wxString initString) : MathCell()
 {
   m_input = NULL;
@@ -46,6 +52,10 @@ GroupCell::GroupCell(int groupType, wxString initString) : MathCell()
   m_groupType = groupType;
   m_lastInOutput = NULL;
   m_appendedCells = NULL;
+  m_timingStart = 0;
+  for (int i = 0; i < GC_TIME_STAGES; i++)
+    m_times[i] = -1;
+  m_dirty = GC_DIRTY_CONTENT;
 
   // set up cell depending on groupType, so we have a working cell
   if (groupType != GC_TYPE_PAGEBREAK) {
@@ -166,6 +176,8 @@ MathCell* GroupCell::Copy(bool all)
 {
   GroupCell* tmp = new GroupCell(m_groupType);
   tmp->Hide(m_hide);
+  for (int i = 0; i < GC_TIME_STAGES; i++)
+    tmp->m_times[i] = m_times[i];
   CopyData(this, tmp);
   if (m_input)
     tmp->SetInput(m_input->Copy(true));
@@ -246,6 +258,52 @@ void GroupCell::RemoveOutput()
   m_hide = false;
 }
 
+/***
+ * Replaces the output cell oldCell with the list newCells and
+ * deletes oldCell. The output has to be recalculated after this.
+ */
+void GroupCell::ReplaceOutputCell(MathCell *oldCell, MathCell *newCells)
+{
+  MathCell *last = newCells;
+  while (last->m_next != NULL)
+  {
+    last->SetParent(this, false);
+    last = last->m_next;
+  }
+  last->SetParent(this, false);
+
+  MathCell *previous = oldCell->m_previous;
+  MathCell *next = oldCell->m_next;
+
+  if (previous == NULL)
+    m_output = newCells;
+  else
+    previous->m_next = newCells;
+  newCells->m_previous = previous;
+
+  last->m_next = next;
+  if (next != NULL)
+    next->m_previous = last;
+
+  if (m_lastInOutput == oldCell)
+    m_lastInOutput = last;
+  if (m_appendedCells == oldCell)
+    m_appendedCells = newCells;
+
+  oldCell->Destroy();
+  delete oldCell;
+
+  // Rebuild the draw list
+  MathCell *tmp = m_output;
+  while (tmp != NULL)
+  {
+    tmp->Unbreak(false);
+    tmp = tmp->m_next;
+  }
+
+  ResetSize();
+}
+
 void GroupCell::AppendOutput(MathCell *cell)
 {
   if (m_output == NULL) {
@@ -286,11 +344,53 @@ void GroupCell::Recalculate(CellParser& parser, int d_fontsize, int m_fontsize)
 
   RecalculateWidths(parser, d_fontsize, false);
   RecalculateSize(parser, d_fontsize, false);
+  m_dirty = 0;
+}
+
+int GroupCell::GetDirty()
+{
+  if (m_width == -1 || m_height == -1)
+    return m_dirty | GC_DIRTY_CONTENT;
+  return m_dirty;
+}
+
+/***
+ * Gives a group which was never laid out a height from the number of
+ * lines in its input and output, so that it can be placed without
+ * measuring it. A group which was laid out before keeps its old size.
+ * The group stays dirty until it is laid out for real.
+ */
+void GroupCell::EstimateSize(int lineHeight)
+{
+  if (m_width != -1 && m_height != -1)
+    return;
+
+  int height = lineHeight;
+  EditorCell *editor = GetEditable();
+  if (editor != NULL)
+    height = lineHeight * (editor->GetValue().Freq(wxT('\n')) + 1);
+
+  if (m_output != NULL && !m_hide) {
+    MathCell *tmp = m_output;
+    while (tmp != NULL) {
+      if (tmp->GetType() == MC_TYPE_IMAGE || tmp->GetType() == MC_TYPE_SLIDE)
+        height += GC_ESTIMATED_IMAGE_HEIGHT;
+      else if (tmp == m_output || tmp->ForceBreakLineHere())
+        height += lineHeight + MC_LINE_SKIP;
+      tmp = tmp->m_next;
+    }
+  }
+
+  m_width = 0;
+  m_height = height;
+  m_center = lineHeight / 2;
+  m_dirty |= GC_DIRTY_CONTENT;
+  ResetData();
 }
 
 void GroupCell::RecalculateWidths(CellParser& parser, int fontsize, bool all)
 {
-  if (m_width == -1 || m_height == -1 || parser.ForceUpdate())
+  if (m_width == -1 || m_height == -1 || m_dirty != 0 || parser.ForceUpdate())
   {
     // special case of 'line cell'
     if (m_groupType == GC_TYPE_PAGEBREAK) {
@@ -332,7 +432,7 @@ void GroupCell::RecalculateWidths(CellParser& parser, int fontsize, bool all)
 
 void GroupCell::RecalculateSize(CellParser& parser, int fontsize, bool all)
 {
-  if (m_width == -1 || m_height == -1 || parser.ForceUpdate())
+  if (m_width == -1 || m_height == -1 || m_dirty != 0 || parser.ForceUpdate())
   {
     // special case
     if (m_groupType == GC_TYPE_PAGEBREAK) {
@@ -566,11 +666,94 @@ void GroupCell::Draw(CellParser& parser, wxPoint point, int fontsize, bool all)
       }
     }
 
+    if (m_groupType == GC_TYPE_CODE)
+      DrawTimeMarker(parser, point);
+
     UnsetPen(parser);
   }
   MathCell::Draw(parser, point, fontsize, all);
 }
 
+/***
+ * Draws a small mark left of the bracket whose color shows how long
+ * the evaluation took: green for 10ms or less, red for 10s or more.
+ */
+void GroupCell::DrawTimeMarker(CellParser& parser, wxPoint point)
+{
+  long time = GetEvaluationTime();
+  if (time < 0)
+    return;
+
+  double heat = 0.0;
+  if (time > 10)
+    heat = log10(time / 10.0) / 3.0;
+  if (heat > 1.0)
+    heat = 1.0;
+
+  wxColour color(int(255 * MIN(1.0, 2.0 * heat)),
+                 int(255 * MIN(1.0, 2.0 * (1.0 - heat))),
+                 0);
+
+  double scale = parser.GetScale();
+  wxDC& dc = parser.GetDC();
+  dc.SetPen(*(wxThePenList->FindOrCreatePen(color, 1, wxSOLID)));
+  dc.SetBrush(*(wxTheBrushList->FindOrCreateBrush(color)));
+  dc.DrawRectangle(point.x - SCALE_PX(14, scale),
+                   point.y - m_center + SCALE_PX(2, scale),
+                   SCALE_PX(3, scale), SCALE_PX(8, scale));
+}
+
+void GroupCell::StartTiming()
+{
+  m_timingStart = wxGetLocalTimeMillis();
+  for (int i = 0; i < GC_TIME_STAGES; i++)
+    m_times[i] = -1;
+}
+
+void GroupCell::SetTime(int stage)
+{
+  if (m_timingStart == 0 || m_times[stage] >= 0)
+    return;
+
+  m_times[stage] = (wxGetLocalTimeMillis() - m_timingStart).ToLong();
+
+  // The stages before this one happened now if they were not recorded
+  for (int i = 0; i < stage; i++)
+    if (m_times[i] < 0)
+      m_times[i] = m_times[stage];
+
+  if (stage == GC_TIME_LAYOUT)
+    m_timingStart = 0;
+}
+
+long GroupCell::GetEvaluationTime()
+{
+  for (int i = GC_TIME_STAGES - 1; i >= 0; i--)
+    if (m_times[i] >= 0)
+      return m_times[i];
+  return -1;
+}
+
+wxString GroupCell::GetTimesString()
+{
+  wxString times;
+  for (int i = 0; i < GC_TIME_STAGES; i++)
+  {
+    if (i > 0)
+      times += wxT(",");
+    times += wxString::Format(wxT("%ld"), m_times[i]);
+  }
+  return times;
+}
+
+void GroupCell::SetTimesString(wxString times)
+{
+  wxStringTokenizer tokens(times, wxT(","));
+  for (int i = 0; i < GC_TIME_STAGES && tokens.HasMoreTokens(); i++)
+    if (!tokens.GetNextToken().ToLong(&m_times[i]))
+      m_times[i] = -1;
+}
+
 wxRect GroupCell::HideRect()
 {
   return wxRect(m_currentPoint.x - 10, m_currentPoint.y - m_center, 10, 10);
@@ -801,6 +984,9 @@ wxString GroupCell::ToXML(bool all)
   // write hidden status
   if (m_hide)
     str += wxT(" hide=\"true\"");
+  // write evaluation times
+  if (m_groupType == GC_TYPE_CODE && GetEvaluationTime() >= 0)
+    str += wxT(" time=\"") + GetTimesString() + wxT("\"");
   str += wxT(">\n");
 
   MathCell *input = GetInput();
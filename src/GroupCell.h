@@ -36,6 +36,25 @@ enum
   GC_TYPE_PAGEBREAK
 };
 
+// Stages of the evaluation of a code cell. The time of each is stored
+// in milliseconds since the cell was sent to maxima.
+enum
+{
+  GC_TIME_OUTPUT,   // first output from maxima
+  GC_TIME_PROMPT,   // maxima is done
+  GC_TIME_PARSED,   // all output is in the document
+  GC_TIME_LAYOUT,   // the output is laid out
+  GC_TIME_STAGES
+};
+
+// What MathCtrl::Recalculate has to lay out again in a group.
+enum
+{
+  GC_DIRTY_CONTENT = 1, // the input or the output changed
+  GC_DIRTY_WIDTH = 2,   // the window width changed, lines are broken again
+  GC_DIRTY_FONTS = 4    // fonts or zoom changed, text is measured again
+};
+
 class GroupCell: public MathCell
 {
 public:
@@ -58,6 +77,7 @@ public:
   EditorCell* GetEditable(); // returns pointer to editor (if there is one)
   void AppendOutput(MathCell *cell);
   void RemoveOutput();
+  void ReplaceOutputCell(MathCell *oldCell, MathCell *newCells);
   // exporting
   wxString ToTeX(bool all, wxString imgDir, wxString filename, int *imgCounter);
   wxString ToTeX(bool all);
@@ -68,6 +88,20 @@ public:
   void Hide(bool hide);
   void SwitchHide();
   wxRect HideRect();
+  // evaluation timing
+  void StartTiming();                // the cell was sent to maxima
+  void SetTime(int stage);           // records the stage if it was not recorded yet
+  long GetTime(int stage) { return m_times[stage]; }
+  long GetEvaluationTime();          // time until the last recorded stage, -1 if not timed
+  bool IsTiming() { return m_timingStart != 0; }
+  wxString GetTimesString();
+  void SetTimesString(wxString times);
+  // layout; ResetSize has the same effect as GC_DIRTY_CONTENT
+  void SetDirty(int what) { m_dirty |= what; }
+  int GetDirty();
+  bool IsDirty() { return GetDirty() != 0; }
+  // gives a group without a size an estimated one, see MathCtrl::Recalculate
+  void EstimateSize(int lineHeight);
   // raw manipulation of GC (should be protected)
   void SetInput(MathCell *input);
   void SetOutput(MathCell *output);
@@ -116,6 +150,10 @@ protected:
   MathCell *m_lastInOutput;
   MathCell *m_appendedCells;
   wxRect m_outputRect;
+  wxLongLong m_timingStart;
+  long m_times[GC_TIME_STAGES];
+  int m_dirty;
+  void DrawTimeMarker(CellParser& parser, wxPoint point);
   wxString ToString(bool all);
 };
 
@@ -0,0 +1,104 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#include "GroupIndex.h"
+
+void GroupIndex::Clear()
+{
+  m_groups.clear();
+  m_heights.clear();
+  m_tree.clear();
+}
+
+void GroupIndex::Add(GroupCell *group, int height)
+{
+  int k = m_groups.size() + 1;
+  m_groups.push_back(group);
+  m_heights.push_back(height);
+  // The node covers the new group and the (k & -k) - 1 groups before it
+  m_tree.push_back(height + Sum(k - 1) - Sum(k - (k & -k)));
+}
+
+/***
+ * The nodes of the first length groups don't depend on the groups
+ * after them, so the tree stays valid when the end is cut off.
+ */
+void GroupIndex::Truncate(int length)
+{
+  if (length >= Size())
+    return;
+  m_groups.resize(length);
+  m_heights.resize(length);
+  m_tree.resize(length);
+}
+
+void GroupIndex::SetHeight(int i, int height)
+{
+  int delta = height - m_heights[i];
+  if (delta == 0)
+    return;
+  m_heights[i] = height;
+  for (int k = i + 1; k <= Size(); k += k & -k)
+    m_tree[k - 1] += delta;
+}
+
+/***
+ * Sum of the heights of the first length groups.
+ */
+int GroupIndex::Sum(int length)
+{
+  int sum = 0;
+  for (int k = length; k > 0; k -= k & -k)
+    sum += m_tree[k - 1];
+  return sum;
+}
+
+/***
+ * Descends the tree from the largest node and counts the groups which
+ * end at or above y.
+ */
+int GroupIndex::Find(int y)
+{
+  int n = Size();
+  if (n == 0)
+    return -1;
+
+  int step = 1;
+  while (2 * step <= n)
+    step *= 2;
+
+  int count = 0;
+  for (; step > 0; step /= 2)
+  {
+    if (count + step <= n && m_tree[count + step - 1] <= y)
+    {
+      count += step;
+      y -= m_tree[count - 1];
+    }
+  }
+
+  return count < n ? count : n - 1;
+}
+
+GroupCell* GroupIndex::GetGroup(int i)
+{
+  if (i < 0 || i >= Size())
+    return NULL;
+  return m_groups[i];
+}
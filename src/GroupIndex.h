@@ -0,0 +1,66 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#ifndef _GROUPINDEX_H_
+#define _GROUPINDEX_H_
+
+#include <wx/wx.h>
+
+#include <vector>
+
+class GroupCell;
+
+// Heights of the groups in the document, in document order, with the
+// prefix sums kept in a Fenwick tree. The height of a group is the
+// space it takes including the skip below it, so the top of group i
+// is the sum of the heights before it. Finding the top of a group,
+// the group at some y and changing the height of one group all take
+// O(log n).
+class GroupIndex
+{
+public:
+  GroupIndex() {};
+  ~GroupIndex() {};
+  void Clear();
+  // Appends the next group.
+  void Add(GroupCell *group, int height);
+  // Keeps only the first length groups.
+  void Truncate(int length);
+  void SetHeight(int i, int height);
+  int GetHeight(int i) { return m_heights[i]; }
+  // Top of group i, relative to the top of the first group.
+  int GetTop(int i) { return Sum(i); }
+  // The group whose space contains y, the first or the last group if y
+  // is above or below all of them, -1 if there are no groups.
+  int Find(int y);
+  // NULL if there is no group i.
+  GroupCell* GetGroup(int i);
+  int GetTotal() { return Sum(Size()); }
+  int Size() { return m_groups.size(); }
+  bool IsEmpty() { return m_groups.empty(); }
+private:
+  int Sum(int length);
+  std::vector<GroupCell*> m_groups;
+  std::vector<int> m_heights;
+  // m_tree[k - 1] holds the sum of the heights of the groups
+  // k - (k & -k) ... k - 1.
+  std::vector<int> m_tree;
+};
+
+#endif // _GROUPINDEX_H_
@@ -27,6 +27,8 @@
 #include "GroupCell.h"
 #include "SlideShowCell.h"
 #include "ImgCell.h"
+#include "DeferredCell.h"
+#include "TextExtentCache.h"
 
 #include <wx/clipbrd.h>
 #include <wx/config.h>
@@ -43,6 +45,7 @@
 #define SCROLL_UNIT 10
 #define CARET_TIMER_TIMEOUT 500
 #define ANIMATION_TIMER_TIMEOUT 300
+#define OUTPUT_TIMER_TIMEOUT 16
 #define AC_MENU_LENGTH 25
 
 void AddLineToFile(wxTextFile& output, wxString s, bool unicode = true);
@@ -51,7 +54,8 @@ enum
 {
   TIMER_ID,
   CARET_TIMER_ID,
-  ANIMATION_TIMER_ID
+  ANIMATION_TIMER_ID,
+  OUTPUT_TIMER_ID
 };
 
 MathCtrl::MathCtrl(wxWindow* parent, int id, wxPoint position, wxSize size) :
@@ -70,6 +74,7 @@ MathCtrl::MathCtrl(wxWindow* parent, int id, wxPoint position, wxSize size) :
   m_clickType = CLICK_TYPE_NONE;
   m_clickInGC = NULL;
   m_last = NULL;
+  m_documentWidth = MC_BASE_INDENT;
   m_hCaretActive = true;
   m_hCaretPosition = NULL; // horizontal caret at the top of document
   m_hCaretPositionStart = m_hCaretPositionEnd = NULL;
@@ -82,6 +87,9 @@ MathCtrl::MathCtrl(wxWindow* parent, int id, wxPoint position, wxSize size) :
   m_timer.SetOwner(this, TIMER_ID);
   m_caretTimer.SetOwner(this, CARET_TIMER_ID);
   m_animationTimer.SetOwner(this, ANIMATION_TIMER_ID);
+  m_outputTimer.SetOwner(this, OUTPUT_TIMER_ID);
+  m_outputGroup = NULL;
+  m_outputChunks = m_outputLayouts = 0;
   m_animate = false;
   m_workingGroup = NULL;
   m_saved = true;
@@ -106,6 +114,10 @@ MathCtrl::~MathCtrl() {
  * Redraw the control
  */
 void MathCtrl::OnPaint(wxPaintEvent& event) {
+  // Output and groups which were not laid out yet can't be drawn
+  if (m_outputGroup != NULL || NeedsLayout())
+    Recalculate();
+
   wxPaintDC dc(this);
 
   wxMemoryDC dcm;
@@ -191,38 +203,14 @@ void MathCtrl::OnPaint(wxPaintEvent& event) {
       }
     }
     //
-    // Mark groupcells currently in queue. TODO better in gc::draw?
-    //
-    if (m_evaluationQueue->GetFirst() != NULL) {
-      MathCell* tmp = m_tree;
-      dcm.SetBrush(*wxTRANSPARENT_BRUSH);
-      while (tmp != NULL)
-      {
-        if (m_evaluationQueue->IsInQueue(dynamic_cast<GroupCell*>(tmp))) {
-          if (m_evaluationQueue->GetFirst() == tmp)
-          {
-            wxRect rect = tmp->GetRect();
-            dcm.SetPen(*(wxThePenList->FindOrCreatePen(parser.GetColor(TS_CELL_BRACKET), 2, wxSOLID)));
-            dcm.DrawRectangle( 3, rect.GetTop() - 2, MC_GROUP_LEFT_INDENT, rect.GetHeight() + 5);
-          }
-          else
-          {
-            wxRect rect = tmp->GetRect();
-            dcm.SetPen(*(wxThePenList->FindOrCreatePen(parser.GetColor(TS_CELL_BRACKET), 1, wxSOLID)));
-            dcm.DrawRectangle( 3, rect.GetTop() - 2, MC_GROUP_LEFT_INDENT, rect.GetHeight() + 5);
-          }
-        }
-        tmp = tmp->m_next;
-      }
-    }
-    //
     // Draw content over
     //
+    // Draw tree, starting with the first group in the update region
+    int groupTop;
+    MathCell* tmp = FindGroup(top, &groupTop);
     wxPoint point;
     point.x = MC_GROUP_LEFT_INDENT;
-    point.y = MC_BASE_INDENT + m_tree->GetMaxCenter();
-    // Draw tree
-    MathCell* tmp = m_tree;
+    point.y = groupTop + tmp->GetMaxCenter();
     drop = tmp->GetMaxDrop();
 
     dcm.SetPen(*(wxThePenList->FindOrCreatePen(parser.GetColor(TS_DEFAULT), 1, wxSOLID)));
@@ -232,12 +220,22 @@ void MathCtrl::OnPaint(wxPaintEvent& event) {
     config->Read(wxT("changeAsterisk"), &changeAsterisk);
     parser.SetChangeAsterisk(changeAsterisk);
 
+    bool queued = m_evaluationQueue->GetFirst() != NULL || !m_kernelQueues.empty();
+
     while (tmp != NULL)
     {
+      if (point.y - tmp->GetMaxCenter() > bottom)
+        break;
       tmp->m_currentPoint.x = point.x;
       tmp->m_currentPoint.y = point.y;
-      if (tmp->DrawThisCell(parser, point))
+      // A group with an estimated size is drawn after it is laid out
+      if (tmp->DrawThisCell(parser, point) && !dynamic_cast<GroupCell*>(tmp)->IsDirty())
+      {
+        // Mark groupcells currently in queue
+        if (queued)
+          DrawQueueMark(dcm, parser, dynamic_cast<GroupCell*>(tmp));
         tmp->Draw(parser, point, MAX(fontsize, MC_MIN_SIZE), false);
+      }
       if (tmp->m_next != NULL) {
         point.x = MC_GROUP_LEFT_INDENT;
         point.y += drop + tmp->m_next->GetMaxCenter();
@@ -326,6 +324,9 @@ GroupCell *MathCtrl::InsertGroupCells(GroupCell* tree, GroupCell* where)
 // m_last is correct
 GroupCell *MathCtrl::UpdateMLast()
 {
+  // Folded groups are not in the document any more
+  m_groupIndex.Clear();
+
   if (!m_tree) {
     m_last = NULL;
     return NULL;
@@ -342,27 +343,32 @@ GroupCell *MathCtrl::UpdateMLast()
 
 /***
  * Add a new line to working group or m_last
+ *
+ * The new cells are laid out by FlushOutput, at most once per
+ * OUTPUT_TIMER_TIMEOUT ms, so that output which arrives in many small
+ * chunks doesn't recalculate the whole document for each chunk.
  */
-void MathCtrl::InsertLine(MathCell *newCell, bool forceNewLine)
+void MathCtrl::InsertLine(MathCell *newCell, bool forceNewLine, GroupCell *group)
 {
   SetActiveCell(NULL, false);
 
   m_saved = false;
 
-  GroupCell *tmp = m_workingGroup;
+  GroupCell *tmp = group;
+
+  if (tmp == NULL)
+    tmp = m_workingGroup;
 
   if (tmp == NULL)
     tmp = m_last;
 
+  if (m_outputGroup != NULL && m_outputGroup != tmp)
+    FlushOutput();
+
   newCell->ForceBreakLine(forceNewLine);
 
   tmp->AppendOutput(newCell);
-  if (newCell->GetType() == MC_TYPE_PROMPT)
-  {
-    m_workingGroup = tmp;
-    ScrollToCell(tmp->GetParent());
-    OpenHCaret();
-  }
+  bool prompt = (newCell->GetType() == MC_TYPE_PROMPT);
 
   while (newCell != NULL)
   {
@@ -373,17 +379,60 @@ void MathCtrl::InsertLine(MathCell *newCell, bool forceNewLine)
   m_selectionStart = NULL;
   m_selectionEnd = NULL;
 
-  wxClientDC dc(this);
-  CellParser parser(dc);
-  parser.SetZoomFactor(m_zoomFactor);
-  parser.SetClientWidth(GetClientSize().GetWidth() - MC_GROUP_LEFT_INDENT - MC_BASE_INDENT);
+  m_outputGroup = tmp;
+  m_outputChunks++;
+
+  // Maxima asks a question - show it immediately. Questions from the
+  // additional maxima processes don't move the caret.
+  if (prompt && group != NULL)
+    FlushOutput();
+  else if (prompt)
+  {
+    m_workingGroup = tmp;
+    OpenHCaret();
+    FlushOutput();
+  }
+  else if (!m_outputTimer.IsRunning())
+    m_outputTimer.Start(OUTPUT_TIMER_TIMEOUT, true);
+}
+
+/***
+ * Lays out the output added by InsertLine since the last call and
+ * scrolls to it.
+ */
+void MathCtrl::FlushOutput()
+{
+  m_outputTimer.Stop();
+
+  if (m_outputGroup == NULL)
+    return;
+
+  GroupCell *tmp = m_outputGroup;
+
+  m_outputLayouts++;
 
-  tmp->RecalculateAppended(parser);
   Recalculate();
+  m_outputGroup = NULL;
+
+  // The output of a cell which is done is laid out now
+  if (tmp->GetTime(GC_TIME_PARSED) >= 0)
+    tmp->SetTime(GC_TIME_LAYOUT);
 
   ScrollToCell(tmp); // also refreshes
 }
 
+/***
+ * How the output and the document were laid out, for the evaluation
+ * times dialog.
+ */
+wxString MathCtrl::GetLayoutStatistics()
+{
+  return wxString::Format(_("Output: %ld lines laid out in %ld passes"),
+                          m_outputChunks, m_outputLayouts) + wxT("\n") +
+         wxString::Format(_("Text sizes: %ld taken from the cache, %ld measured"),
+                          TextExtentCache::GetHits(), TextExtentCache::GetMisses());
+}
+
 /***
  * Recalculate dimensions of cells
  */
@@ -391,6 +440,16 @@ void MathCtrl::RecalculateForce() {
   Recalculate(true);
 }
 
+/***
+ * Lays out the groups which are dirty and moves the others to their
+ * new positions. With force all text is measured again.
+ *
+ * In the virtual layout only the dirty groups near the window, from one
+ * window height above it to one below it, are laid out. The others get
+ * an estimated size and are laid out when they are scrolled near, see
+ * NeedsLayout. The first group in the window stays where it is on the
+ * screen when the groups above it get their real size.
+ */
 void MathCtrl::Recalculate(bool force)
 {
   GroupCell *tmp = m_tree;
@@ -398,28 +457,102 @@ void MathCtrl::Recalculate(bool force)
   wxClientDC dc(this);
   CellParser parser(dc);
   parser.SetZoomFactor(m_zoomFactor);
-  parser.SetForceUpdate(force);
   parser.SetClientWidth(GetClientSize().GetWidth() - MC_GROUP_LEFT_INDENT - MC_BASE_INDENT);
   int d_fontsize = parser.GetDefaultFontSize();
   int m_fontsize = parser.GetMathFontSize();
 
+  if (m_outputGroup != NULL)
+    m_outputGroup->RecalculateAppended(parser);
+
   wxPoint point;
   point.x = MC_GROUP_LEFT_INDENT;
   point.y = MC_BASE_INDENT ;
-
+  m_documentWidth = MC_BASE_INDENT;
+
+  bool virtualLayout = false;
+  wxConfig::Get()->Read(wxT("virtualLayout"), &virtualLayout);
+  int viewX, viewTop, viewWidth, viewHeight;
+  CalcUnscrolledPosition(0, 0, &viewX, &viewTop);
+  GetClientSize(&viewWidth, &viewHeight);
+  int layoutTop = viewTop - viewHeight;
+  int layoutBottom = viewTop + 2 * viewHeight;
+  int lineHeight = d_fontsize + d_fontsize / 2;
+
+  GroupCell *anchor = NULL;
+  int anchorTop = -1, newAnchorTop = -1;
+  if (virtualLayout && !m_groupIndex.IsEmpty())
+    anchor = FindGroup(viewTop, &anchorTop);
+
+  int i = 0;
   while (tmp != NULL) {
-    tmp->Recalculate(parser, d_fontsize, m_fontsize);
+    if (force)
+      tmp->SetDirty(GC_DIRTY_FONTS);
+    if (tmp == anchor)
+      newAnchorTop = point.y;
+
+    int dirty = tmp->GetDirty();
+    if (dirty != 0 && virtualLayout) {
+      tmp->EstimateSize(lineHeight);
+      if (point.y > layoutBottom ||
+          point.y + tmp->GetMaxHeight() + MC_GROUP_SKIP < layoutTop)
+        dirty = 0; // keeps the estimated size
+    }
+
+    if (dirty != 0) {
+      parser.SetForceUpdate((dirty & GC_DIRTY_FONTS) != 0);
+      tmp->Recalculate(parser, d_fontsize, m_fontsize);
+    }
+    else
+      tmp->ResetData();
 //    tmp->RecalculateWidths(parser, MAX(fontsize, MC_MIN_SIZE), false);
 //    tmp->RecalculateSize(parser, MAX(fontsize, MC_MIN_SIZE), false);
     point.y += tmp->GetMaxCenter();
     tmp->m_currentPoint.x = point.x;
     tmp->m_currentPoint.y = point.y;
     point.y += tmp->GetMaxDrop();
-    tmp = dynamic_cast<GroupCell*>(tmp->m_next);
     point.y += MC_GROUP_SKIP;
+
+    // Update the index. From the first group which is not at the
+    // same place in the index, the rest of it is built again.
+    int height = tmp->GetMaxHeight() + MC_GROUP_SKIP;
+    if (m_groupIndex.GetGroup(i) == tmp)
+      m_groupIndex.SetHeight(i, height);
+    else {
+      m_groupIndex.Truncate(i);
+      m_groupIndex.Add(tmp, height);
+    }
+    i++;
+
+    m_documentWidth = MAX(2 * MC_BASE_INDENT + tmp->GetWidth(), m_documentWidth);
+    tmp = dynamic_cast<GroupCell*>(tmp->m_next);
   }
+  m_groupIndex.Truncate(i);
 
   AdjustSize();
+
+  if (newAnchorTop >= 0 && newAnchorTop != anchorTop)
+    Scroll(-1, MAX(viewTop + newAnchorTop - anchorTop, 0) / SCROLL_UNIT);
+}
+
+/***
+ * True if a group in the window was not laid out yet. In the virtual
+ * layout these are the groups which were scrolled into view.
+ */
+bool MathCtrl::NeedsLayout()
+{
+  int x, top, width, height;
+  CalcUnscrolledPosition(0, 0, &x, &top);
+  GetClientSize(&width, &height);
+
+  int groupTop;
+  GroupCell *tmp = FindGroup(top, &groupTop);
+  while (tmp != NULL && groupTop <= top + height) {
+    if (tmp->IsDirty())
+      return true;
+    groupTop += tmp->GetMaxHeight() + MC_GROUP_SKIP;
+    tmp = dynamic_cast<GroupCell*>(tmp->m_next);
+  }
+  return false;
 }
 
 /***
@@ -431,7 +564,13 @@ void MathCtrl::OnSize(wxSizeEvent& event) {
   if (m_tree != NULL) {
     m_selectionStart = NULL;
     m_selectionEnd = NULL;
-    RecalculateForce();
+    // Text keeps its size, only lines are broken again
+    GroupCell *tmp = m_tree;
+    while (tmp != NULL) {
+      tmp->SetDirty(GC_DIRTY_WIDTH);
+      tmp = dynamic_cast<GroupCell*>(tmp->m_next);
+    }
+    Recalculate();
   }
   else
     AdjustSize();
@@ -580,6 +719,7 @@ GroupCell *MathCtrl::TearOutTree(GroupCell *start, GroupCell *end) {
   MathCell *prev = start->m_previous;
   MathCell *next = end->m_next;
 
+  m_groupIndex.Clear();
   end->m_next = end->m_nextToDraw = NULL;
   start->m_previous = start->m_previousToDraw = NULL;
 
@@ -777,7 +917,7 @@ void MathCtrl::OnMouseLeftDown(wxMouseEvent& event) {
   m_hCaretActive = false;
   SetActiveCell(NULL, false);
 
-  GroupCell * tmp = m_tree;
+  GroupCell * tmp = FindGroup(m_down.y);
   wxRect rect;
   GroupCell * clickedBeforeGC = NULL;
   GroupCell * clickedInGC = NULL;
@@ -941,7 +1081,7 @@ void MathCtrl::ClickNDrag(wxPoint down, wxPoint up) {
       int ytop    = MIN( down.y, up.y );
       int ybottom = MAX( down.y, up.y );
       // find out group cells between ytop and ybottom (including these two points)
-      GroupCell * tmp = m_tree;
+      GroupCell * tmp = FindGroup(ytop);
       while (tmp != NULL) {
         rect = tmp->GetRect();
         if (ytop <= rect.GetBottom()) {
@@ -956,7 +1096,7 @@ void MathCtrl::ClickNDrag(wxPoint down, wxPoint up) {
         return;
       }
 
-      tmp = m_tree;
+      tmp = FindGroup(ybottom);
       while (tmp != NULL) {
         rect = tmp->GetRect();
         if (ybottom < rect.GetTop()) {
@@ -1168,7 +1308,7 @@ bool MathCtrl::CanDeleteSelection() {
     MathCell* tmp = m_selectionStart;
     while (tmp != NULL)
     {
-      if (m_evaluationQueue->IsInQueue(dynamic_cast<GroupCell*>(tmp)))
+      if (IsInAnyQueue(dynamic_cast<GroupCell*>(tmp)))
         return false;
 
       if (tmp == m_selectionEnd)
@@ -1188,6 +1328,8 @@ void MathCtrl::DeleteSelection(bool deletePrompt) {
       m_workingGroup != NULL)
     return;
 
+  FlushOutput();
+
   m_hCaretPositionStart = m_hCaretPositionEnd = NULL;
 
   GroupCell *start = dynamic_cast<GroupCell*>(m_selectionStart->GetParent());
@@ -1801,20 +1943,23 @@ void MathCtrl::OnChar(wxKeyEvent& event) {
  * Get maximum x and y in the tree.
  */
 void MathCtrl::GetMaxPoint(int* width, int* height) {
-  MathCell* tmp = m_tree;
-  int currentHeight= MC_BASE_INDENT;
-  int currentWidth= MC_BASE_INDENT;
-  *width = MC_BASE_INDENT;
-  *height = MC_BASE_INDENT;
+  *width = m_documentWidth;
+  *height = MC_BASE_INDENT + m_groupIndex.GetTotal();
+}
 
-  while (tmp != NULL) {
-    currentHeight += tmp->GetMaxHeight();
-    currentHeight += MC_GROUP_SKIP;
-    *height = currentHeight;
-    currentWidth = MC_BASE_INDENT + tmp->GetWidth();
-    *width = MAX(currentWidth + MC_BASE_INDENT, *width);
-    tmp = tmp->m_next;
-  }
+/***
+ * Returns the group whose space (the group and the skip below it)
+ * contains y and sets top to the top of that space. Groups above it
+ * end before y. Without an index, e.g. after the document was changed
+ * and before it is laid out again, this is the first group.
+ */
+GroupCell* MathCtrl::FindGroup(int y, int *top) {
+  int i = m_groupIndex.Find(y - MC_BASE_INDENT);
+  if (top != NULL)
+    *top = MC_BASE_INDENT + (i < 0 ? 0 : m_groupIndex.GetTop(i));
+  if (i < 0)
+    return m_tree;
+  return m_groupIndex.GetGroup(i);
 }
 
 /***
@@ -1894,6 +2039,9 @@ void MathCtrl::OnTimer(wxTimerEvent& event) {
           m_animate = false;
       }
       break;
+    case OUTPUT_TIMER_ID:
+      FlushOutput();
+      break;
     case CARET_TIMER_ID:
       {
         if (m_activeCell != NULL) {
@@ -1918,12 +2066,15 @@ void MathCtrl::OnTimer(wxTimerEvent& event) {
 void MathCtrl::DestroyTree() {
   m_hCaretActive = false;
   m_hCaretPosition = NULL;
+  m_outputTimer.Stop();
+  m_outputGroup = NULL;
   DestroyTree(m_tree);
   m_tree = m_last = NULL;
 }
 
 void MathCtrl::DestroyTree(MathCell* tmp) {
   MathCell* tmp1;
+  m_groupIndex.Clear();
   while (tmp != NULL) {
     tmp1 = tmp;
     tmp = tmp->m_next;
@@ -2645,7 +2796,7 @@ wxString ConvertToUnicode(wxString str)
 #endif
 }
 
-bool MathCtrl::ExportToWXMX(wxString file)
+bool MathCtrl::ExportToWXMX(wxString file, ResultCache *cache)
 {
   // delete file if it already exists
   if(wxFileExists(file))
@@ -2681,6 +2832,16 @@ bool MathCtrl::ExportToWXMX(wxString file)
 
   output << wxT("\n</wxMaximaDocument>");
 
+  // The images of the cache are numbered after the images of the document
+  if (cache != NULL) {
+    wxString xml = cache->ToXML();
+    if (xml.Length() > 0) {
+      zip.PutNextEntry(wxT("cache.xml"));
+      output << wxT("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+      output << ConvertToUnicode(xml);
+    }
+  }
+
   // save images from memory to zip file
   wxFileSystem *fsystem = new wxFileSystem();
   fsystem->AddHandler(new wxMemoryFSHandler);
@@ -2737,7 +2898,22 @@ void MathCtrl::OnDoubleClick(wxMouseEvent &event) {
   }
   else if (m_selectionStart != NULL) {
     GroupCell *parent = dynamic_cast<GroupCell*>(m_selectionStart->GetParent());
-    parent->SelectOutput(&m_selectionStart, &m_selectionEnd);
+    DeferredCell *deferred = NULL;
+    if (m_selectionStart == m_selectionEnd)
+      deferred = dynamic_cast<DeferredCell*>(m_selectionStart);
+
+    // Show the long expression
+    if (deferred != NULL) {
+      wxBusyCursor wait;
+      MathCell *cells = deferred->Expand();
+      if (cells == NULL)
+        return;
+      m_selectionStart = m_selectionEnd = NULL;
+      parent->ReplaceOutputCell(deferred, cells);
+      RecalculateForce();
+    }
+    else
+      parent->SelectOutput(&m_selectionStart, &m_selectionEnd);
     Refresh();
   }
 }
@@ -2830,6 +3006,8 @@ void MathCtrl::AddDocumentToEvaluationQueue()
 {
   GroupCell* tmp = m_tree;
   while (tmp != NULL) {
+    // Cells evaluated in an additional process are not evaluated twice
+    if (!IsInAnyQueue(tmp))
       m_evaluationQueue->AddToQueue((GroupCell*) tmp);
     tmp = dynamic_cast<GroupCell*>(tmp->m_next);
   }
@@ -2844,6 +3022,7 @@ void MathCtrl::AddSelectionToEvaluationQueue()
     return;
   GroupCell* tmp = dynamic_cast<GroupCell*>(m_selectionStart);
   while (tmp != NULL) {
+    if (!IsInAnyQueue(tmp))
       m_evaluationQueue->AddToQueue((GroupCell*) tmp);
     if (tmp == m_selectionEnd)
       break;
@@ -2854,13 +3033,72 @@ void MathCtrl::AddSelectionToEvaluationQueue()
 
 void MathCtrl::AddCellToEvaluationQueue(GroupCell* gc)
 {
-    m_evaluationQueue->AddToQueue((GroupCell*) gc);
+    // A cell which is already waiting keeps its place
+    if (!IsInAnyQueue(gc))
+      m_evaluationQueue->AddToQueue((GroupCell*) gc);
     SetHCaret((MathCell *) gc);
 }
+
+/***
+ * Moves the active or selected cell to the front of the evaluation
+ * queue, after the cells which were already sent to maxima. A cell
+ * which is not in a queue is added first.
+ */
+void MathCtrl::EvaluateCellNext()
+{
+  GroupCell *group = NULL;
+  if (m_activeCell != NULL)
+    group = dynamic_cast<GroupCell*>(m_activeCell->GetParent());
+  else if (m_selectionStart != NULL && m_selectionStart->GetType() == MC_TYPE_GROUP)
+    group = dynamic_cast<GroupCell*>(m_selectionStart);
+  if (group == NULL)
+    return;
+
+  if (!m_evaluationQueue->IsInQueue(group)) {
+    if (IsInAnyQueue(group))
+      return;
+    m_evaluationQueue->AddToQueue(group);
+  }
+  m_evaluationQueue->MoveToFront(group);
+  Refresh();
+}
 void MathCtrl::ClearEvaluationQueue()
 {
-  while (m_evaluationQueue->GetFirst() != NULL)
-    m_evaluationQueue->RemoveFirst();
+  m_evaluationQueue->Clear();
+  for (unsigned int i = 0; i < m_kernelQueues.size(); i++)
+    m_kernelQueues[i]->Clear();
+}
+
+/***
+ * Marks a cell in one of the queues under its bracket, with a thicker
+ * line if it is being evaluated. Called for each cell which is drawn.
+ */
+void MathCtrl::DrawQueueMark(wxDC& dc, CellParser& parser, GroupCell *group)
+{
+  if (!IsInAnyQueue(group))
+    return;
+
+  bool first = (m_evaluationQueue->GetFirst() == group);
+  for (unsigned int i = 0; i < m_kernelQueues.size(); i++)
+    if (m_kernelQueues[i]->GetFirst() == group)
+      first = true;
+
+  wxRect rect = group->GetRect();
+  dc.SetBrush(*wxTRANSPARENT_BRUSH);
+  dc.SetPen(*(wxThePenList->FindOrCreatePen(parser.GetColor(TS_CELL_BRACKET), first ? 2 : 1, wxSOLID)));
+  dc.DrawRectangle( 3, rect.GetTop() - 2, MC_GROUP_LEFT_INDENT, rect.GetHeight() + 5);
+  dc.SetPen(*(wxThePenList->FindOrCreatePen(parser.GetColor(TS_DEFAULT), 1, wxSOLID)));
+  dc.SetBrush(*(wxTheBrushList->FindOrCreateBrush(parser.GetColor(TS_DEFAULT))));
+}
+
+bool MathCtrl::IsInAnyQueue(GroupCell *group)
+{
+  if (m_evaluationQueue->IsInQueue(group))
+    return true;
+  for (unsigned int i = 0; i < m_kernelQueues.size(); i++)
+    if (m_kernelQueues[i]->IsInQueue(group))
+      return true;
+  return false;
 }
 //////// end of EvaluationQueue related stuff ////////////////
 
@@ -3146,6 +3384,8 @@ void MathCtrl::SelectAll()
 
 void MathCtrl::DivideCell()
 {
+  FlushOutput();
+
   if (m_activeCell == NULL)
     return;
 
@@ -3171,6 +3411,8 @@ void MathCtrl::DivideCell()
 
 void MathCtrl::MergeCells()
 {
+  FlushOutput();
+
   wxString newcell = wxEmptyString;
   MathCell *tmp = m_selectionStart;
   if (!tmp)
@@ -3701,6 +3943,7 @@ BEGIN_EVENT_TABLE(MathCtrl, wxScrolledCanvas)
   EVT_TIMER(TIMER_ID, MathCtrl::OnTimer)
   EVT_TIMER(CARET_TIMER_ID, MathCtrl::OnTimer)
   EVT_TIMER(ANIMATION_TIMER_ID, MathCtrl::OnTimer)
+  EVT_TIMER(OUTPUT_TIMER_ID, MathCtrl::OnTimer)
   EVT_KEY_DOWN(MathCtrl::OnKeyDown)
   EVT_CHAR(MathCtrl::OnChar)
   EVT_ERASE_BACKGROUND(MathCtrl::OnEraseBackground)
@@ -23,12 +23,17 @@
 #include <wx/wx.h>
 #include <wx/textfile.h>
 
+#include <vector>
+
 #include "MathCell.h"
 #include "EditorCell.h"
 #include "GroupCell.h"
 #include "EvaluationQueue.h"
+#include "GroupIndex.h"
 #include "Autocomplete.h"
 
+class ResultCache;
+
 #if !wxCHECK_VERSION(2,9,0)
   typedef wxScrolledWindow wxScrolledCanvas;
 #endif
@@ -86,7 +91,12 @@ public:
   void DestroyTree(MathCell* tree);
   MathCell* CopyTree();
   GroupCell *InsertGroupCells(GroupCell* tree, GroupCell* where = NULL);
-  void InsertLine(MathCell *newLine, bool forceNewLine = false);
+  void InsertLine(MathCell *newLine, bool forceNewLine = false, GroupCell *group = NULL);
+  void FlushOutput();
+  GroupCell *GetOutputGroup() { return m_outputGroup; }
+  long GetOutputChunks() { return m_outputChunks; }   // lines added with InsertLine
+  long GetOutputLayouts() { return m_outputLayouts; } // layouts done for them
+  wxString GetLayoutStatistics();
   void Recalculate(bool force = false);
   void RecalculateForce();
   void ClearDocument(); // used when opening new file in wxMaxima.cpp
@@ -126,7 +136,7 @@ public:
   bool ExportToHTML(wxString file);
   void ExportToMAC(wxTextFile& output, MathCell *tree, bool wxm);
   bool ExportToMAC(wxString file);
-	bool ExportToWXMX(wxString file);	//export to xml compatible file
+	bool ExportToWXMX(wxString file, ResultCache *cache = NULL);	//export to xml compatible file
   bool ExportToTeX(wxString file);
   wxString GetString(bool lb = false);
   MathCell* GetTree()
@@ -180,8 +190,14 @@ public:
   void AddDocumentToEvaluationQueue();
   void AddSelectionToEvaluationQueue();
   void AddCellToEvaluationQueue(GroupCell* gc);
+  void EvaluateCellNext();
   void ClearEvaluationQueue();
   EvaluationQueue* m_evaluationQueue;
+  // queues of the additional maxima processes
+  void AddKernelQueue(EvaluationQueue *queue) { m_kernelQueues.push_back(queue); }
+  void ClearKernelQueues() { m_kernelQueues.clear(); }
+  bool IsInAnyQueue(GroupCell *group);
+  void DrawQueueMark(wxDC& dc, CellParser& parser, GroupCell *group);
   // methods for folding
   GroupCell *UpdateMLast();
   GroupCell *ToggleFold(GroupCell *which);
@@ -210,6 +226,8 @@ protected:
   MathCell* CopySelection();
   MathCell* CopySelection(MathCell* start, MathCell* end, bool asData = false);
   void GetMaxPoint(int* width, int* height);
+  GroupCell* FindGroup(int y, int *top = NULL);
+  bool NeedsLayout();
   void OnTimer(wxTimerEvent& event);
   void OnMouseExit(wxMouseEvent& event);
   void OnMouseEnter(wxMouseEvent& event);
@@ -242,6 +260,8 @@ protected:
   bool m_mouseOutside;
   GroupCell *m_tree;
   GroupCell *m_last;
+  GroupIndex m_groupIndex; // positions of the groups, built by Recalculate
+  int m_documentWidth;
   GroupCell *m_workingGroup;
   MathCell *m_selectionStart;
   MathCell *m_selectionEnd;
@@ -251,7 +271,10 @@ protected:
   CellParser *m_selectionParser;
   bool m_switchDisplayCaret;
   bool m_editingEnabled;
-  wxTimer m_timer, m_caretTimer, m_animationTimer;
+  std::vector<EvaluationQueue*> m_kernelQueues;
+  wxTimer m_timer, m_caretTimer, m_animationTimer, m_outputTimer;
+  GroupCell *m_outputGroup; // group with output which is not laid out yet
+  long m_outputChunks, m_outputLayouts;
   bool m_animate;
   wxBitmap *m_memory;
   bool m_saved;
@@ -21,7 +21,6 @@
 #include <wx/config.h>
 #include <wx/tokenzr.h>
 #include <wx/sstream.h>
-#include <wx/regex.h>
 
 #include "MathParser.h"
 
@@ -44,6 +43,7 @@
 #include "SubSupCell.h"
 #include "SlideShowCell.h"
 #include "GroupCell.h"
+#include "DeferredCell.h"
 
 #define MAXLENGTH 50000
 
@@ -52,6 +52,7 @@ MathParser::MathParser(wxString zipfile)
   m_ParserStyle = MC_TYPE_DEFAULT;
   m_FracStyle = FC_NORMAL;
   m_highlight = false;
+  ReadConfig();
   if (zipfile.Length() > 0) {
     m_fileSystem = new wxFileSystem();
     m_fileSystem->ChangePathTo(wxT("file:") + zipfile + wxT("#zip:/"), true);
@@ -66,6 +67,12 @@ MathParser::~MathParser()
     delete m_fileSystem;
 }
 
+void MathParser::ReadConfig()
+{
+  m_showLong = false;
+  wxConfig::Get()->Read(wxT("showLong"), &m_showLong);
+}
+
 // ParseCellTag
 // This function is responsible for creating
 // a tree of groupcells when loading XML document.
@@ -91,6 +98,11 @@ MathCell* MathParser::ParseCellTag(wxXmlNode* node)
 
   if (type == wxT("code")) {
     group = new GroupCell(GC_TYPE_CODE);
+#if wxCHECK_VERSION(2,9,0)
+    group->SetTimesString(node->GetAttribute(wxT("time"), wxEmptyString));
+#else
+    group->SetTimesString(node->GetPropVal(wxT("time"), wxEmptyString));
+#endif
     wxXmlNode *children = node->GetChildren();
     while (children) {
       if (children->GetName() == wxT("input")) {
@@ -387,7 +399,6 @@ MathCell* MathParser::ParseFunTag(wxXmlNode* node)
 
 MathCell* MathParser::ParseText(wxXmlNode* node, int style)
 {
-  TextCell* cell = new TextCell;
   wxString str;
   if (node != NULL && (str = node->GetContent()) != wxEmptyString)
   {
@@ -395,6 +406,15 @@ MathCell* MathParser::ParseText(wxXmlNode* node, int style)
     wxString str1(str.wc_str(wxConvUTF8), *wxConvCurrent);
     str = str1;
 #endif
+  }
+  return ParseText(str, style);
+}
+
+MathCell* MathParser::ParseText(wxString str, int style)
+{
+  TextCell* cell = new TextCell;
+  if (str != wxEmptyString)
+  {
     if (style == TS_NUMBER)
     {
       if (str.Length() > 100) // This could be made configurable.
@@ -410,9 +430,16 @@ MathCell* MathParser::ParseText(wxXmlNode* node, int style)
 
 MathCell* MathParser::ParseCharCode(wxXmlNode* node, int style)
 {
-  TextCell* cell = new TextCell;
   wxString str;
-  if (node != NULL && (str = node->GetContent()) != wxEmptyString)
+  if (node != NULL)
+    str = node->GetContent();
+  return ParseCharCode(str, style);
+}
+
+MathCell* MathParser::ParseCharCode(wxString str, int style)
+{
+  TextCell* cell = new TextCell;
+  if (str != wxEmptyString)
   {
     long code;
     if (str.ToLong(&code))
@@ -909,6 +936,22 @@ MathCell* MathParser::ParseTag(wxXmlNode* node, bool all)
         else
           cell->AppendCell(tmp);
       }
+      else if (tagName == wxT("deferred"))
+      {
+        wxString xml;
+        if (node->GetChildren() != NULL)
+          xml = node->GetChildren()->GetContent();
+#if !wxUSE_UNICODE
+        wxString xml1(xml.wc_str(wxConvUTF8), *wxConvCurrent);
+        xml = xml1;
+#endif
+        MathCell *tmp = new DeferredCell(xml, m_ParserStyle);
+        tmp->ForceBreakLine(true);
+        if (cell == NULL)
+          cell = tmp;
+        else
+          cell->AppendCell(tmp);
+      }
       else if (tagName == wxT("editor"))
       {
         if (cell == NULL)
@@ -979,31 +1022,905 @@ MathCell* MathParser::ParseTag(wxXmlNode* node, bool all)
   return cell;
 }
 
+///--------------------------------------------------------------------------------
+///  Streaming parser
+///--------------------------------------------------------------------------------
+
+/***
+ * Parses the xml in s without building a wxXmlDocument. The cells are
+ * the same as ParseTag creates from the document. If s is not well
+ * formed or contains tags which are not used in maxima output, *ok is
+ * set to false and NULL is returned.
+ */
+MathCell* MathParser::ParseStream(const wxString &s, bool *ok)
+{
+  m_stream = s.c_str();
+  m_streamPos = 0;
+  m_streamLength = s.Length();
+  m_streamEmptyTag = false;
+  m_streamToken = STREAM_EOF;
+
+  MathCell *cell = NULL;
+
+  StreamNextToken();
+  if (m_streamToken == STREAM_START)
+  {
+    wxString root = m_streamName;
+    StreamNextToken();
+    cell = StreamParseNodes();
+    StreamEndTag(root);
+  }
+  else
+    m_streamToken = STREAM_ERROR;
+
+  *ok = (m_streamToken == STREAM_EOF);
+  if (!*ok && cell != NULL)
+  {
+    delete cell;
+    cell = NULL;
+  }
+
+  // The strings in the cells must not be shared with the parser when
+  // the cells are passed to another thread.
+  m_stream = NULL;
+  m_streamName = m_streamText = wxEmptyString;
+  m_streamAttrNames.Clear();
+  m_streamAttrValues.Clear();
+  return cell;
+}
+
+/***
+ * Reads the next text, start tag or end tag. An empty element <tag/>
+ * is reported as a start tag followed by an end tag.
+ */
+void MathParser::StreamNextToken()
+{
+  if (m_streamToken == STREAM_ERROR)
+    return;
+
+  if (m_streamEmptyTag)
+  {
+    m_streamEmptyTag = false;
+    m_streamToken = STREAM_END;
+    return;
+  }
+
+  while (true)
+  {
+    if (m_streamPos >= m_streamLength)
+    {
+      m_streamToken = STREAM_EOF;
+      return;
+    }
+
+    if (m_stream[m_streamPos] != wxT('<'))
+    {
+      if (!StreamReadText(wxT('<'), m_streamText))
+        break;
+      // wxXmlDocument drops whitespace between tags, too
+      size_t i = 0;
+      while (i < m_streamText.Length() && wxIsspace(m_streamText[i]))
+        i++;
+      if (i == m_streamText.Length())
+        continue;
+      m_streamToken = STREAM_TEXT;
+      return;
+    }
+
+    m_streamPos++;
+    if (m_streamPos >= m_streamLength)
+      break;
+
+    wxChar c = m_stream[m_streamPos];
+
+    // Processing instructions and comments
+    if (c == wxT('?') || c == wxT('!'))
+    {
+      const wxChar *end = wxT("?>");
+      if (c == wxT('!'))
+      {
+        if (m_streamPos + 2 >= m_streamLength ||
+            m_stream[m_streamPos + 1] != wxT('-') || m_stream[m_streamPos + 2] != wxT('-'))
+          break;
+        end = wxT("-->");
+      }
+      size_t endLength = wxStrlen(end);
+      while (m_streamPos < m_streamLength &&
+             wxStrncmp(m_stream + m_streamPos, end, endLength) != 0)
+        m_streamPos++;
+      if (m_streamPos >= m_streamLength)
+        break;
+      m_streamPos += endLength;
+      continue;
+    }
+
+    // End tag
+    if (c == wxT('/'))
+    {
+      m_streamPos++;
+      if (!StreamReadName(m_streamName))
+        break;
+      while (m_streamPos < m_streamLength && wxIsspace(m_stream[m_streamPos]))
+        m_streamPos++;
+      if (m_streamPos >= m_streamLength || m_stream[m_streamPos] != wxT('>'))
+        break;
+      m_streamPos++;
+      m_streamToken = STREAM_END;
+      return;
+    }
+
+    // Start tag with attributes
+    if (!StreamReadName(m_streamName))
+      break;
+    m_streamAttrNames.Clear();
+    m_streamAttrValues.Clear();
+    while (m_streamPos < m_streamLength)
+    {
+      while (m_streamPos < m_streamLength && wxIsspace(m_stream[m_streamPos]))
+        m_streamPos++;
+      if (m_streamPos >= m_streamLength)
+        break;
+
+      c = m_stream[m_streamPos];
+      if (c == wxT('>'))
+      {
+        m_streamPos++;
+        m_streamToken = STREAM_START;
+        return;
+      }
+      if (c == wxT('/'))
+      {
+        if (m_streamPos + 1 >= m_streamLength || m_stream[m_streamPos + 1] != wxT('>'))
+          break;
+        m_streamPos += 2;
+        m_streamEmptyTag = true;
+        m_streamToken = STREAM_START;
+        return;
+      }
+
+      wxString name, value;
+      if (!StreamReadName(name))
+        break;
+      if (m_streamPos + 1 >= m_streamLength || m_stream[m_streamPos] != wxT('='))
+        break;
+      wxChar quote = m_stream[++m_streamPos];
+      if (quote != wxT('"') && quote != wxT('\''))
+        break;
+      m_streamPos++;
+      if (!StreamReadText(quote, value) || m_streamPos >= m_streamLength)
+        break;
+      m_streamPos++;
+      m_streamAttrNames.Add(name);
+      m_streamAttrValues.Add(value);
+    }
+    break;
+  }
+
+  m_streamToken = STREAM_ERROR;
+}
+
+bool MathParser::StreamReadName(wxString &name)
+{
+  size_t start = m_streamPos;
+  while (m_streamPos < m_streamLength)
+  {
+    wxChar c = m_stream[m_streamPos];
+    if (wxIsspace(c) || c == wxT('>') || c == wxT('/') || c == wxT('=') ||
+        c == wxT('<'))
+      break;
+    m_streamPos++;
+  }
+  name = wxString(m_stream + start, m_streamPos - start);
+  return name.Length() > 0;
+}
+
+/***
+ * Reads text up to the character end and replaces the entity and
+ * character references.
+ */
+bool MathParser::StreamReadText(wxChar end, wxString &text)
+{
+  size_t start = m_streamPos;
+  while (m_streamPos < m_streamLength && m_stream[m_streamPos] != end &&
+         m_stream[m_streamPos] != wxT('&'))
+    m_streamPos++;
+  text = wxString(m_stream + start, m_streamPos - start);
+
+  while (m_streamPos < m_streamLength && m_stream[m_streamPos] == wxT('&'))
+  {
+    size_t semicolon = m_streamPos;
+    while (semicolon < m_streamLength && m_stream[semicolon] != wxT(';') &&
+           semicolon - m_streamPos < 12)
+      semicolon++;
+    if (semicolon >= m_streamLength || m_stream[semicolon] != wxT(';'))
+      return false;
+
+    wxString entity(m_stream + m_streamPos + 1, semicolon - m_streamPos - 1);
+    if (entity == wxT("lt"))
+      text += wxT('<');
+    else if (entity == wxT("gt"))
+      text += wxT('>');
+    else if (entity == wxT("amp"))
+      text += wxT('&');
+    else if (entity == wxT("quot"))
+      text += wxT('"');
+    else if (entity == wxT("apos"))
+      text += wxT('\'');
+    else if (entity.StartsWith(wxT("#")))
+    {
+      unsigned long code;
+      bool valid;
+      if (entity.StartsWith(wxT("#x")))
+        valid = entity.Mid(2).ToULong(&code, 16);
+      else
+        valid = entity.Mid(1).ToULong(&code);
+      if (!valid)
+        return false;
+      text += (wxChar)code;
+    }
+    else
+      return false;
+
+    m_streamPos = start = semicolon + 1;
+    while (m_streamPos < m_streamLength && m_stream[m_streamPos] != end &&
+           m_stream[m_streamPos] != wxT('&'))
+      m_streamPos++;
+    text += wxString(m_stream + start, m_streamPos - start);
+  }
+
+  return true;
+}
+
+wxString MathParser::StreamAttribute(wxString name, wxString def)
+{
+  int index = m_streamAttrNames.Index(name);
+  if (index == wxNOT_FOUND)
+    return def;
+  return m_streamAttrValues[index];
+}
+
+/***
+ * Parses the next child of the current element into cell. Returns
+ * false if there are no more children.
+ */
+bool MathParser::StreamChild(MathCell **cell)
+{
+  if (m_streamToken != STREAM_TEXT && m_streamToken != STREAM_START)
+    return false;
+  *cell = StreamParseNode();
+  return true;
+}
+
+/***
+ * Skips the children of the current element which were not used and
+ * reads its end tag.
+ */
+void MathParser::StreamEndTag(wxString name)
+{
+  MathCell *cell;
+  while (StreamChild(&cell))
+    if (cell != NULL)
+      delete cell;
+
+  if (m_streamToken != STREAM_END || m_streamName != name)
+    m_streamToken = STREAM_ERROR;
+  else
+    StreamNextToken();
+}
+
+/***
+ * Parses all nodes up to the end tag of the current element. This is
+ * ParseTag(node, true).
+ */
+MathCell* MathParser::StreamParseNodes()
+{
+  MathCell *tree = NULL;
+  MathCell *last = NULL;
+
+  while (m_streamToken == STREAM_TEXT || m_streamToken == STREAM_START)
+  {
+    wxString altCopy;
+    if (m_streamToken == STREAM_START)
+      altCopy = StreamAttribute(wxT("altCopy"));
+
+    MathCell *cell = StreamParseNode();
+    if (cell == NULL)
+      continue;
+
+    if (altCopy.Length())
+      cell->SetAltCopyText(altCopy);
+
+    if (tree == NULL)
+      tree = cell;
+    else
+      last->AppendCell(cell);
+    last = cell;
+  }
+
+  return tree;
+}
+
+/***
+ * Parses one node. This is ParseTag(node, false).
+ */
+MathCell* MathParser::StreamParseNode()
+{
+  if (m_streamToken == STREAM_TEXT)
+  {
+    MathCell *cell = ParseText(m_streamText);
+    StreamNextToken();
+    return cell;
+  }
+  return StreamParseElement();
+}
+
+MathCell* MathParser::StreamParseElement()
+{
+  wxString tagName(m_streamName);
+  MathCell *cell = NULL;
+
+  if (tagName == wxT("v"))
+    return StreamParseText(TS_VARIABLE);
+  else if (tagName == wxT("t"))
+    return StreamParseText(TS_DEFAULT);
+  else if (tagName == wxT("n"))
+    return StreamParseText(TS_NUMBER);
+  else if (tagName == wxT("h"))
+  {
+    cell = StreamParseText(TS_DEFAULT);
+    cell->m_isHidden = true;
+    return cell;
+  }
+  else if (tagName == wxT("g"))
+    return StreamParseText(TS_GREEK_CONSTANT);
+  else if (tagName == wxT("s"))
+    return StreamParseText(TS_SPECIAL_CONSTANT);
+  else if (tagName == wxT("fnm"))
+    return StreamParseText(TS_FUNCTION);
+  else if (tagName == wxT("st"))
+    return StreamParseText(TS_STRING);
+  else if (tagName == wxT("lbl"))
+  {
+    cell = StreamParseText(TS_LABEL);
+    cell->ForceBreakLine(true);
+    return cell;
+  }
+  else if (tagName == wxT("ascii"))
+  {
+    wxString str;
+    StreamNextToken();
+    if (m_streamToken == STREAM_TEXT)
+    {
+      str = m_streamText;
+      StreamNextToken();
+    }
+    StreamEndTag(tagName);
+    return ParseCharCode(str);
+  }
+  else if (tagName == wxT("f"))
+    return StreamParseFracTag();
+  else if (tagName == wxT("e"))
+    return StreamParseSupTag();
+  else if (tagName == wxT("i"))
+    return StreamParseSubTag();
+  else if (tagName == wxT("ie"))
+    return StreamParseSubSupTag();
+  else if (tagName == wxT("fn"))
+    return StreamParseFunTag();
+  else if (tagName == wxT("d"))
+    return StreamParseDiffTag();
+  else if (tagName == wxT("sm"))
+    return StreamParseSumTag();
+  else if (tagName == wxT("in"))
+    return StreamParseIntTag();
+  else if (tagName == wxT("at"))
+    return StreamParseAtTag();
+  else if (tagName == wxT("lm"))
+    return StreamParseLimitTag();
+  else if (tagName == wxT("tb"))
+    return StreamParseTableTag();
+  else if (tagName == wxT("img"))
+    return StreamParseImgTag();
+  else if (tagName == wxT("slide"))
+    return StreamParseSlideTag();
+  else if (tagName == wxT("p"))
+  {
+    bool print = !StreamHasAttributes();
+    StreamNextToken();
+    ParenCell* paren = new ParenCell;
+    paren->SetInner(StreamParseNodes(), m_ParserStyle);
+    paren->SetHighlight(m_highlight);
+    paren->SetStyle(TS_VARIABLE);
+    if (!print)
+      paren->SetPrint(false);
+    cell = paren;
+  }
+  else if (tagName == wxT("q"))
+  {
+    StreamNextToken();
+    SqrtCell* sqrt = new SqrtCell;
+    sqrt->SetInner(StreamParseNodes());
+    sqrt->SetType(m_ParserStyle);
+    sqrt->SetStyle(TS_VARIABLE);
+    sqrt->SetHighlight(m_highlight);
+    cell = sqrt;
+  }
+  else if (tagName == wxT("a"))
+  {
+    StreamNextToken();
+    AbsCell* abs = new AbsCell;
+    abs->SetInner(StreamParseNodes());
+    abs->SetType(m_ParserStyle);
+    abs->SetStyle(TS_VARIABLE);
+    abs->SetHighlight(m_highlight);
+    cell = abs;
+  }
+  else if (tagName == wxT("mspace"))
+  {
+    StreamNextToken();
+    cell = new TextCell(wxT(" "));
+  }
+  else if ((tagName == wxT("mth")) || (tagName == wxT("line")))
+  {
+    StreamNextToken();
+    cell = StreamParseNodes();
+    if (cell != NULL)
+      cell->ForceBreakLine(true);
+    else
+      cell = new TextCell(wxT(" "));
+  }
+  else if (tagName == wxT("hl"))
+  {
+    StreamNextToken();
+    bool highlight = m_highlight;
+    m_highlight = true;
+    cell = StreamParseNodes();
+    m_highlight = highlight;
+  }
+  else if (tagName == wxT("editor") || tagName == wxT("cell"))
+  {
+    // Only in documents - leave them to ParseTag
+    m_streamToken = STREAM_ERROR;
+    return NULL;
+  }
+  else
+  {
+    // r and unknown tags
+    StreamNextToken();
+    cell = StreamParseNodes();
+  }
+
+  StreamEndTag(tagName);
+  return cell;
+}
+
+MathCell* MathParser::StreamParseText(int style)
+{
+  wxString tagName(m_streamName);
+  wxString str;
+
+  StreamNextToken();
+  if (m_streamToken == STREAM_TEXT)
+  {
+    str = m_streamText;
+    StreamNextToken();
+  }
+  StreamEndTag(tagName);
+
+  return ParseText(str, style);
+}
+
+MathCell* MathParser::StreamParseFracTag()
+{
+  bool choose = StreamHasAttributes();
+  MathCell *child;
+  FracCell *frac = new FracCell;
+  frac->SetFracStyle(m_FracStyle);
+  frac->SetHighlight(m_highlight);
+  StreamNextToken();
+  if (StreamChild(&child))
+  {
+    frac->SetNum(child);
+    if (StreamChild(&child))
+    {
+      frac->SetDenom(child);
+      if (choose)
+        frac->SetFracStyle(FC_CHOOSE);
+      frac->SetType(m_ParserStyle);
+      frac->SetStyle(TS_VARIABLE);
+      frac->SetupBreakUps();
+      StreamEndTag(wxT("f"));
+      return frac;
+    }
+  }
+  delete frac;
+  StreamEndTag(wxT("f"));
+  return NULL;
+}
+
+MathCell* MathParser::StreamParseDiffTag()
+{
+  MathCell *child;
+  DiffCell *diff = new DiffCell;
+  StreamNextToken();
+  int fc = m_FracStyle;
+  m_FracStyle = FC_DIFF;
+  bool hasDiff = StreamChild(&child);
+  m_FracStyle = fc;
+  if (hasDiff)
+  {
+    diff->SetDiff(child);
+    if (m_streamToken == STREAM_TEXT || m_streamToken == STREAM_START)
+    {
+      diff->SetBase(StreamParseNodes());
+      diff->SetType(m_ParserStyle);
+      diff->SetStyle(TS_VARIABLE);
+      StreamEndTag(wxT("d"));
+      return diff;
+    }
+  }
+  delete diff;
+  StreamEndTag(wxT("d"));
+  return NULL;
+}
+
+MathCell* MathParser::StreamParseSupTag()
+{
+  MathCell *child;
+  ExptCell *expt = new ExptCell;
+  if (StreamHasAttributes())
+    expt->IsMatrix(true);
+  StreamNextToken();
+  if (StreamChild(&child))
+  {
+    expt->SetBase(child);
+    if (StreamChild(&child))
+    {
+      child->SetExponentFlag();
+      expt->SetPower(child);
+      expt->SetType(m_ParserStyle);
+      expt->SetStyle(TS_VARIABLE);
+      StreamEndTag(wxT("e"));
+      return expt;
+    }
+  }
+  delete expt;
+  StreamEndTag(wxT("e"));
+  return NULL;
+}
+
+MathCell* MathParser::StreamParseSubSupTag()
+{
+  MathCell *child;
+  SubSupCell *subsup = new SubSupCell;
+  StreamNextToken();
+  if (StreamChild(&child))
+  {
+    subsup->SetBase(child);
+    if (StreamChild(&child))
+    {
+      child->SetExponentFlag();
+      subsup->SetIndex(child);
+      if (StreamChild(&child))
+      {
+        child->SetExponentFlag();
+        subsup->SetExponent(child);
+        subsup->SetType(m_ParserStyle);
+        subsup->SetStyle(TS_VARIABLE);
+        StreamEndTag(wxT("ie"));
+        return subsup;
+      }
+    }
+  }
+  delete subsup;
+  StreamEndTag(wxT("ie"));
+  return NULL;
+}
+
+MathCell* MathParser::StreamParseSubTag()
+{
+  MathCell *child;
+  SubCell *sub = new SubCell;
+  StreamNextToken();
+  if (StreamChild(&child))
+  {
+    sub->SetBase(child);
+    if (StreamChild(&child))
+    {
+      child->SetExponentFlag();
+      sub->SetIndex(child);
+      sub->SetType(m_ParserStyle);
+      sub->SetStyle(TS_VARIABLE);
+      StreamEndTag(wxT("i"));
+      return sub;
+    }
+  }
+  delete sub;
+  StreamEndTag(wxT("i"));
+  return NULL;
+}
+
+MathCell* MathParser::StreamParseAtTag()
+{
+  MathCell *child;
+  AtCell *at = new AtCell;
+  StreamNextToken();
+  if (StreamChild(&child))
+  {
+    at->SetBase(child);
+    at->SetHighlight(m_highlight);
+    if (StreamChild(&child))
+    {
+      at->SetIndex(child);
+      at->SetType(m_ParserStyle);
+      at->SetStyle(TS_VARIABLE);
+      StreamEndTag(wxT("at"));
+      return at;
+    }
+  }
+  delete at;
+  StreamEndTag(wxT("at"));
+  return NULL;
+}
+
+MathCell* MathParser::StreamParseFunTag()
+{
+  MathCell *child;
+  FunCell *fun = new FunCell;
+  StreamNextToken();
+  if (StreamChild(&child))
+  {
+    fun->SetName(child);
+    if (StreamChild(&child))
+    {
+      fun->SetType(m_ParserStyle);
+      fun->SetStyle(TS_VARIABLE);
+      fun->SetArg(child);
+      StreamEndTag(wxT("fn"));
+      return fun;
+    }
+  }
+  delete fun;
+  StreamEndTag(wxT("fn"));
+  return NULL;
+}
+
+MathCell* MathParser::StreamParseLimitTag()
+{
+  MathCell *child;
+  LimitCell *limit = new LimitCell;
+  StreamNextToken();
+  if (StreamChild(&child))
+  {
+    limit->SetName(child);
+    if (StreamChild(&child))
+    {
+      limit->SetUnder(child);
+      if (StreamChild(&child))
+      {
+        limit->SetBase(child);
+        limit->SetType(m_ParserStyle);
+        limit->SetStyle(TS_VARIABLE);
+        StreamEndTag(wxT("lm"));
+        return limit;
+      }
+    }
+  }
+  delete limit;
+  StreamEndTag(wxT("lm"));
+  return NULL;
+}
+
+MathCell* MathParser::StreamParseSumTag()
+{
+  MathCell *child;
+  SumCell *sum = new SumCell;
+  wxString type = StreamAttribute(wxT("type"), wxT("sum"));
+  if (type == wxT("prod"))
+    sum->SetSumStyle(SM_PROD);
+  sum->SetHighlight(m_highlight);
+  StreamNextToken();
+  if (StreamChild(&child))
+  {
+    sum->SetUnder(child);
+    if (StreamChild(&child))
+    {
+      if (type != wxT("lsum"))
+        sum->SetOver(child);
+      else if (child != NULL)
+        delete child;
+      if (StreamChild(&child))
+      {
+        sum->SetBase(child);
+        sum->SetType(m_ParserStyle);
+        sum->SetStyle(TS_VARIABLE);
+        StreamEndTag(wxT("sm"));
+        return sum;
+      }
+    }
+  }
+  delete sum;
+  StreamEndTag(wxT("sm"));
+  return NULL;
+}
+
+MathCell* MathParser::StreamParseIntTag()
+{
+  MathCell *child;
+  IntCell *in = new IntCell;
+  bool definite = !StreamHasAttributes();
+  in->SetHighlight(m_highlight);
+  StreamNextToken();
+  if (definite)
+  {
+    in->SetIntStyle(INT_DEF);
+    if (StreamChild(&child))
+    {
+      in->SetUnder(child);
+      if (StreamChild(&child))
+      {
+        in->SetOver(child);
+        if (StreamChild(&child))
+        {
+          in->SetBase(child);
+          if (m_streamToken == STREAM_TEXT || m_streamToken == STREAM_START)
+          {
+            in->SetVar(StreamParseNodes());
+            in->SetType(m_ParserStyle);
+            in->SetStyle(TS_VARIABLE);
+            StreamEndTag(wxT("in"));
+            return in;
+          }
+        }
+      }
+    }
+  }
+  else
+  {
+    if (StreamChild(&child))
+    {
+      in->SetBase(child);
+      if (m_streamToken == STREAM_TEXT || m_streamToken == STREAM_START)
+      {
+        in->SetVar(StreamParseNodes());
+        in->SetType(m_ParserStyle);
+        in->SetStyle(TS_VARIABLE);
+        StreamEndTag(wxT("in"));
+        return in;
+      }
+    }
+  }
+  delete in;
+  StreamEndTag(wxT("in"));
+  return NULL;
+}
+
+MathCell* MathParser::StreamParseTableTag()
+{
+  MatrCell *matrix = new MatrCell;
+  matrix->SetHighlight(m_highlight);
+
+  if (StreamAttribute(wxT("special"), wxT("false")) == wxT("true"))
+    matrix->SetSpecialFlag(true);
+  if (StreamAttribute(wxT("inference"), wxT("false")) == wxT("true"))
+  {
+    matrix->SetInferenceFlag(true);
+    matrix->SetSpecialFlag(true);
+  }
+  if (StreamAttribute(wxT("colnames"), wxT("false")) == wxT("true"))
+    matrix->ColNames(true);
+  if (StreamAttribute(wxT("rownames"), wxT("false")) == wxT("true"))
+    matrix->RowNames(true);
+
+  StreamNextToken();
+  while (m_streamToken == STREAM_TEXT || m_streamToken == STREAM_START)
+  {
+    matrix->NewRow();
+    if (m_streamToken == STREAM_TEXT)
+    {
+      StreamNextToken();
+      continue;
+    }
+
+    wxString row = m_streamName;
+    MathCell *child;
+    StreamNextToken();
+    while (StreamChild(&child))
+    {
+      matrix->NewColumn();
+      matrix->AddNewCell(child);
+    }
+    StreamEndTag(row);
+  }
+  StreamEndTag(wxT("tb"));
+
+  matrix->SetType(m_ParserStyle);
+  matrix->SetStyle(TS_VARIABLE);
+  matrix->SetDimension();
+  return matrix;
+}
+
+MathCell* MathParser::StreamParseImgTag()
+{
+  bool del = StreamAttribute(wxT("del"), wxT("yes")) != wxT("no");
+  bool rect = StreamAttribute(wxT("rect"), wxT("true")) != wxT("false");
+  wxString filename;
+
+  StreamNextToken();
+  if (m_streamToken == STREAM_TEXT)
+  {
+    filename = m_streamText;
+    StreamNextToken();
+  }
+  StreamEndTag(wxT("img"));
+
+  ImgCell *img;
+  if (m_fileSystem) // loading from zip
+    img = new ImgCell(filename, false, m_fileSystem);
+  else
+    img = new ImgCell(filename, del, NULL);
+
+  if (!rect)
+    img->DrawRectangle(false);
+
+  return img;
+}
+
+MathCell* MathParser::StreamParseSlideTag()
+{
+  wxString str;
+
+  StreamNextToken();
+  if (m_streamToken == STREAM_TEXT)
+  {
+    str = m_streamText;
+    StreamNextToken();
+  }
+  StreamEndTag(wxT("slide"));
+
+  SlideShow *slide = new SlideShow(m_fileSystem);
+  wxArrayString images;
+  wxStringTokenizer tokens(str, wxT(";"));
+  while (tokens.HasMoreTokens()) {
+    wxString token = tokens.GetNextToken();
+    if (token.Length())
+      images.Add(token);
+  }
+  slide->LoadImages(images);
+
+  return slide;
+}
+
 /***
  * Parse the string s, which is (correct) xml fragment.
  * Put the result in line.
  */
-MathCell* MathParser::ParseLine(wxString s, int style)
+MathCell* MathParser::ParseLine(wxString s, int style, bool full)
 {
   m_ParserStyle = style;
   m_FracStyle = FC_NORMAL;
   m_highlight = false;
   MathCell* cell = NULL;
 
-  wxConfigBase* config = wxConfig::Get();
-  bool showLong = false;
-  config->Read(wxT("showLong"), &showLong);
-
-  wxRegEx graph(wxT("[[:cntrl:]]"));
-
+  // Control characters are not allowed in xml
+  for (size_t i = 0; i < s.Length(); i++)
+  {
+    if (wxIscntrl(s[i]))
 #if wxUSE_UNICODE
-  graph.Replace(&s, wxT("\xFFFD"));
+      s[i] = wxT('\xFFFD');
 #else
-  graph.Replace(&s, wxT("?"));
+      s[i] = wxT('?');
 #endif
+  }
 
-  if (s.Length() < MAXLENGTH || showLong)
+  if (s.Length() < MAXLENGTH || m_showLong || full)
   {
+#if wxUSE_UNICODE
+    bool ok;
+    cell = ParseStream(s, &ok);
+    if (ok)
+      return cell;
+#endif
 
     wxXmlDocument xml;
 
@@ -1023,7 +1940,7 @@ MathCell* MathParser::ParseLine(wxString s, int style)
   }
   else
   {
-    cell = new TextCell(_(" << Expression too long to display! >>"));
+    cell = new DeferredCell(s, style);
     cell->ForceBreakLine(true);
   }
   return cell;
@@ -33,14 +33,18 @@ class MathParser
 public:
   MathParser(wxString zipfile = wxEmptyString);
   ~MathParser();
-  MathCell* ParseLine(wxString s, int style = MC_TYPE_DEFAULT);
+  // Long expressions are only parsed if full is true or showLong is set
+  MathCell* ParseLine(wxString s, int style = MC_TYPE_DEFAULT, bool full = false);
   MathCell* ParseTag(wxXmlNode* node, bool all = true);
+  void ReadConfig();
 private:
   MathCell* ParseCellTag(wxXmlNode* node);
   MathCell* ParseEditorTag(wxXmlNode* node);
   MathCell* ParseFracTag(wxXmlNode* node);
   MathCell* ParseText(wxXmlNode* node, int style = TS_DEFAULT);
+  MathCell* ParseText(wxString str, int style = TS_DEFAULT);
   MathCell* ParseCharCode(wxXmlNode* node, int style = TS_DEFAULT);
+  MathCell* ParseCharCode(wxString str, int style = TS_DEFAULT);
   MathCell* ParseSupTag(wxXmlNode* node);
   MathCell* ParseSubTag(wxXmlNode* node);
   MathCell* ParseAbsTag(wxXmlNode* node);
@@ -55,9 +59,53 @@ private:
   MathCell* ParseLimitTag(wxXmlNode* node);
   MathCell* ParseParenTag(wxXmlNode* node);
   MathCell* ParseSubSupTag(wxXmlNode* node);
+  // Streaming parser for maxima output: creates the cells while
+  // reading the xml, without building a wxXmlDocument first.
+  MathCell* ParseStream(const wxString &s, bool *ok);
+  void StreamNextToken();
+  bool StreamReadName(wxString &name);
+  bool StreamReadText(wxChar end, wxString &text);
+  wxString StreamAttribute(wxString name, wxString def = wxEmptyString);
+  bool StreamHasAttributes() { return m_streamAttrNames.GetCount() > 0; }
+  bool StreamChild(MathCell **cell);
+  void StreamEndTag(wxString name);
+  MathCell* StreamParseNodes();
+  MathCell* StreamParseNode();
+  MathCell* StreamParseElement();
+  MathCell* StreamParseText(int style);
+  MathCell* StreamParseFracTag();
+  MathCell* StreamParseSupTag();
+  MathCell* StreamParseSubTag();
+  MathCell* StreamParseSubSupTag();
+  MathCell* StreamParseAtTag();
+  MathCell* StreamParseFunTag();
+  MathCell* StreamParseDiffTag();
+  MathCell* StreamParseSumTag();
+  MathCell* StreamParseIntTag();
+  MathCell* StreamParseLimitTag();
+  MathCell* StreamParseTableTag();
+  MathCell* StreamParseImgTag();
+  MathCell* StreamParseSlideTag();
+  enum {
+    STREAM_TEXT,
+    STREAM_START,
+    STREAM_END,
+    STREAM_EOF,
+    STREAM_ERROR
+  };
+  const wxChar *m_stream;
+  size_t m_streamPos;
+  size_t m_streamLength;
+  int m_streamToken;
+  bool m_streamEmptyTag;
+  wxString m_streamName;
+  wxString m_streamText;
+  wxArrayString m_streamAttrNames;
+  wxArrayString m_streamAttrValues;
   int m_ParserStyle;
   int m_FracStyle;
   bool m_highlight;
+  bool m_showLong;
   wxFileSystem *m_fileSystem; // used for loading pictures in <img> and <slide>
 };
 
@@ -0,0 +1,115 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#include "MaximaKernel.h"
+
+#include <wx/process.h>
+
+MaximaKernel::MaximaKernel(int number)
+{
+  m_number = number;
+  m_state = KERNEL_IDLE;
+  m_started = 0;
+  m_pid = -1;
+  m_client = NULL;
+  m_workingGroup = NULL;
+  m_lastPrompt = wxT("(%i1) ");
+  next = NULL;
+}
+
+MaximaKernel::~MaximaKernel()
+{
+  Kill();
+  m_queue.Clear();
+}
+
+void MaximaKernel::Connect(wxSocketBase *client)
+{
+  m_client = client;
+  m_client->SetClientData(this);
+  m_client->SetNotify(wxSOCKET_INPUT_FLAG | wxSOCKET_OUTPUT_FLAG | wxSOCKET_LOST_FLAG);
+  m_input.SetSocket(m_client);
+  m_client->Notify(true);
+}
+
+wxSocketBase *MaximaKernel::TakeClient()
+{
+  wxSocketBase *client = m_client;
+  m_client = NULL;
+  m_input.SetSocket(NULL);
+  m_pid = -1;
+  m_state = KERNEL_IDLE;
+  return client;
+}
+
+void MaximaKernel::Send(wxString s)
+{
+  if (m_client == NULL)
+    return;
+
+  s.Replace(wxT("\n"), wxT(" "));
+  s.Append(wxT("\n"));
+
+#if wxUSE_UNICODE
+  m_input.Write(s.utf8_str(), strlen(s.utf8_str()));
+#else
+  m_input.Write(s.c_str(), s.Length());
+#endif
+}
+
+/***
+ * Kills the process and closes the connection. The pid is the one
+ * maxima reported in its first prompt, or the pid of the process
+ * wxExecute started if maxima never got that far.
+ */
+void MaximaKernel::Kill()
+{
+  if (m_client != NULL)
+  {
+    m_client->Notify(false);
+    m_client->Destroy();
+    m_client = NULL;
+    m_input.SetSocket(NULL);
+  }
+
+  if (m_pid > 0)
+    wxProcess::Kill(m_pid, wxSIGKILL);
+  m_pid = -1;
+
+  if (m_state != KERNEL_IDLE)
+    m_state = KERNEL_FAILED;
+}
+
+wxString MaximaKernel::GetStatus()
+{
+  switch (m_state)
+  {
+  case KERNEL_STARTING:
+  case KERNEL_SETUP:
+    return _("starting");
+  case KERNEL_READY:
+    return _("ready");
+  case KERNEL_BUSY:
+    return _("busy");
+  case KERNEL_FAILED:
+    return _("stopped");
+  default:
+    return _("waiting");
+  }
+}
@@ -0,0 +1,91 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#ifndef _MAXIMAKERNEL_H_
+#define _MAXIMAKERNEL_H_
+
+#include <wx/wx.h>
+#include <wx/socket.h>
+
+#include "OutputScanner.h"
+#include "SendQueue.h"
+#include "EvaluationQueue.h"
+
+// An additional maxima process which evaluates cells next to the main
+// one. Kernels connect to the same server as the main maxima and are
+// used only with framed output. Each kernel has its own queue; the
+// first cell in the queue is the one which is being evaluated.
+class MaximaKernel
+{
+public:
+  enum {
+    KERNEL_IDLE,     // not started yet
+    KERNEL_STARTING, // waiting for the connection and the first prompt
+    KERNEL_SETUP,    // waiting until maxima switches to framed output
+    KERNEL_READY,
+    KERNEL_BUSY,
+    KERNEL_FAILED
+  };
+  MaximaKernel(int number);
+  ~MaximaKernel();
+  void Connect(wxSocketBase *client);
+  void Send(wxString s);
+  void Kill();
+  int GetNumber() { return m_number; }
+  int GetState() { return m_state; }
+  void SetState(int state)
+  {
+    m_state = state;
+    if (state == KERNEL_STARTING)
+      m_started = wxGetLocalTime();
+  }
+  // When the process was started, in seconds
+  long GetStarted() { return m_started; }
+  bool IsUsable() { return m_state == KERNEL_READY || m_state == KERNEL_BUSY; }
+  wxSocketBase *GetClient() { return m_client; }
+  // Passes the connection to the caller; the process is not killed
+  // when the kernel is deleted.
+  wxSocketBase *TakeClient();
+  long GetPid() { return m_pid; }
+  void SetPid(long pid) { m_pid = pid; }
+  wxString GetLastPrompt() { return m_lastPrompt; }
+  void SetLastPrompt(wxString prompt) { m_lastPrompt = prompt; }
+  // The cell which is being evaluated; NULL if it was removed from the queue.
+  GroupCell *GetWorkingGroup()
+  {
+    GroupCell *first = m_queue.GetFirst();
+    return first == m_workingGroup ? first : NULL;
+  }
+  void SetWorkingGroup(GroupCell *group) { m_workingGroup = group; }
+  wxString GetStatus();
+  OutputScanner m_output;
+  SendQueue m_input;
+  EvaluationQueue m_queue;
+  MaximaKernel *next;
+private:
+  int m_number;
+  int m_state;
+  long m_started;
+  long m_pid;
+  wxSocketBase *m_client;
+  GroupCell *m_workingGroup;
+  wxString m_lastPrompt;
+};
+
+#endif // _MAXIMAKERNEL_H_
@@ -0,0 +1,117 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#include "OutputBudget.h"
+
+#include <wx/config.h>
+
+#define TAIL_LINES 100
+#define TAIL_LENGTH 100000
+
+OutputBudget::OutputBudget()
+{
+  ReadConfig();
+  Reset();
+}
+
+void OutputBudget::ReadConfig()
+{
+  m_maxLines = 10000;
+  m_maxLength = 10000; // in kB
+  wxConfig::Get()->Read(wxT("outputLinesLimit"), &m_maxLines);
+  wxConfig::Get()->Read(wxT("outputSizeLimit"), &m_maxLength);
+  m_maxLength *= 1024;
+}
+
+void OutputBudget::Reset()
+{
+  m_lines = m_length = 0;
+  m_overflow = false;
+  m_tail.Clear();
+  m_tailStart = 0;
+  m_tailLines = m_tailLength = 0;
+  m_droppedLines = 0;
+}
+
+long OutputBudget::CountLines(const wxString &s)
+{
+  long lines = 1;
+  for (size_t i = 0; i < s.Length(); i++)
+    if (s[i] == wxT('\n'))
+      lines++;
+  return lines;
+}
+
+bool OutputBudget::Add(const wxString &s)
+{
+  long lines = CountLines(s);
+
+  if (!m_overflow)
+  {
+    m_lines += lines;
+    m_length += s.Length();
+    if ((m_maxLines <= 0 || m_lines <= m_maxLines) &&
+        (m_maxLength <= 0 || m_length <= m_maxLength))
+      return true;
+    m_overflow = true;
+  }
+
+  m_tail.Add(s);
+  m_tailLines += lines;
+  m_tailLength += s.Length();
+
+  // Keep at least the last chunk
+  while ((m_tailLines > TAIL_LINES || m_tailLength > TAIL_LENGTH) &&
+         m_tail.GetCount() - m_tailStart > 1)
+    DropFirst();
+
+  return false;
+}
+
+void OutputBudget::DropFirst()
+{
+  wxString s = m_tail[m_tailStart];
+  long lines = CountLines(s);
+
+  m_tailLines -= lines;
+  m_tailLength -= s.Length();
+  m_droppedLines += lines;
+
+  m_tail[m_tailStart] = wxEmptyString;
+  m_tailStart++;
+
+  // Remove the dropped chunks from the array only from time to time
+  if (m_tailStart > m_tail.GetCount() / 2)
+  {
+    m_tail.RemoveAt(0, m_tailStart);
+    m_tailStart = 0;
+  }
+}
+
+/***
+ * Returns the chunks in the tail and starts a new budget.
+ */
+wxArrayString OutputBudget::TakeTail()
+{
+  wxArrayString tail;
+  for (size_t i = m_tailStart; i < m_tail.GetCount(); i++)
+    tail.Add(m_tail[i]);
+  Reset();
+  return tail;
+}
@@ -0,0 +1,60 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#ifndef _OUTPUTBUDGET_H_
+#define _OUTPUTBUDGET_H_
+
+#include <wx/wx.h>
+#include <wx/string.h>
+
+// Limits the output one evaluation adds to the document.
+//
+// Add is called for each chunk of output. Until the limit for lines or
+// characters is reached the chunk should be displayed. After that the
+// chunks are kept in a tail which only holds the last few lines, and
+// the lines which fall out of the tail are counted. The tail is taken
+// with TakeTail when maxima displays a prompt.
+class OutputBudget
+{
+public:
+  OutputBudget();
+  void ReadConfig();
+  // Starts the budget for a new evaluation.
+  void Reset();
+  // Returns false if the chunk went to the tail.
+  bool Add(const wxString &s);
+  bool IsOverflowing() { return m_overflow; }
+  long GetDroppedLines() { return m_droppedLines; }
+  wxArrayString TakeTail();
+private:
+  static long CountLines(const wxString &s);
+  void DropFirst();
+  long m_maxLines;
+  long m_maxLength;
+  long m_lines;
+  long m_length;
+  bool m_overflow;
+  wxArrayString m_tail;
+  size_t m_tailStart;
+  long m_tailLines;
+  long m_tailLength;
+  long m_droppedLines;
+};
+
+#endif // _OUTPUTBUDGET_H_
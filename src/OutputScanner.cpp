@@ -0,0 +1,246 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#include "OutputScanner.h"
+
+#include <string.h>
+
+OutputScanner::OutputScanner()
+{
+  m_start = 0;
+  m_partialLength = 0;
+}
+
+void OutputScanner::Append(const char *data, size_t length)
+{
+#if wxUSE_UNICODE
+  wxMemoryBuffer bytes(m_partialLength + length);
+  if (m_partialLength > 0)
+    bytes.AppendData(m_partial, m_partialLength);
+  bytes.AppendData((void *)data, length);
+
+  const char *buffer = (const char *)bytes.GetData();
+  size_t total = bytes.GetDataLen();
+  size_t complete = CompleteUTF8Length(buffer, total);
+
+  m_partialLength = total - complete;
+  if (m_partialLength > 0)
+    memcpy(m_partial, buffer + complete, m_partialLength);
+
+  if (complete > 0)
+  {
+    wxString text(buffer, wxConvUTF8, complete);
+    // Don't lose the output if maxima sends something which is not UTF-8
+    if (text.Length() == 0)
+      text = wxString(buffer, wxConvISO8859_1, complete);
+    m_text += text;
+  }
+#else
+  m_text += wxString(data, length);
+#endif
+}
+
+/***
+ * Returns the length of the initial part of data which does not end
+ * in an incomplete UTF-8 sequence.
+ */
+size_t OutputScanner::CompleteUTF8Length(const char *data, size_t length)
+{
+  size_t i = length;
+
+  // Skip the continuation bytes at the end
+  while (i > 0 && length - i < 3 && (data[i - 1] & 0xC0) == 0x80)
+    i--;
+
+  if (i == 0)
+    return length;
+
+  unsigned char lead = data[i - 1];
+  size_t needed = 1;
+  if ((lead & 0xE0) == 0xC0)
+    needed = 2;
+  else if ((lead & 0xF0) == 0xE0)
+    needed = 3;
+  else if ((lead & 0xF8) == 0xF0)
+    needed = 4;
+
+  if (length - (i - 1) < needed)
+    return i - 1;
+
+  return length;
+}
+
+int OutputScanner::Find(const wxString &token)
+{
+  size_t from = m_start;
+
+  ScanPositions::iterator it = m_scanned.find(token);
+  if (it != m_scanned.end() && it->second > from)
+    from = it->second;
+
+  size_t pos = m_text.find(token, from);
+
+  if (pos == wxString::npos)
+  {
+    // The next search only needs to look at the last characters
+    // which could still be the beginning of token.
+    size_t scanned = 0;
+    if (m_text.Length() >= token.Length())
+      scanned = m_text.Length() - token.Length() + 1;
+    m_scanned[token] = scanned > from ? scanned : from;
+    return -1;
+  }
+
+  m_scanned[token] = pos;
+  return pos - m_start;
+}
+
+wxString OutputScanner::Mid(int start, int length)
+{
+  if (length <= 0)
+    return wxEmptyString;
+  return m_text.Mid(m_start + start, length);
+}
+
+void OutputScanner::Consume(int length)
+{
+  m_start += length;
+  if (m_start > m_text.Length())
+    m_start = m_text.Length();
+
+  if (m_start == m_text.Length())
+  {
+    m_text = wxEmptyString;
+    m_scanned.clear();
+    m_start = 0;
+  }
+  else if (m_start > m_text.Length() / 2)
+    Compact();
+}
+
+/***
+ * Reads the records maxima sends in framed mode. A record is
+ * STX, type, length of the payload, ':', payload, ETX. Prompts have
+ * no length, they end with ETX. The length is in characters; if it
+ * doesn't match (lisps which count bytes) the record ends at ETX.
+ * Text outside of records is returned when the next record starts.
+ */
+int OutputScanner::NextRecord(wxChar *type, wxString *data)
+{
+  static const wxString stx = wxT("\x02");
+  static const wxString etx = wxT("\x03");
+
+  int start = Find(stx);
+  if (start == -1)
+    return SCAN_WAIT;
+  if (start > 0) {
+    *data = Left(start);
+    Consume(start);
+    return SCAN_TEXT;
+  }
+
+  int available = Length();
+  if (available < 3)
+    return SCAN_WAIT;
+
+  long length = -1;
+  int pos = 2;
+  while (pos < available && wxIsdigit(GetChar(pos)))
+    pos++;
+  if (pos == available)
+    return SCAN_WAIT;
+  if (pos > 2)
+    Mid(2, pos - 2).ToLong(&length);
+  pos++; // skip ':'
+
+  int end = -1;
+  if (length >= 0 && pos + length < available &&
+      GetChar(pos + length) == etx[0])
+    end = pos + length;
+  else {
+    end = Find(etx);
+    if (end == -1)
+      return SCAN_WAIT;
+  }
+
+  *type = GetChar(1);
+  *data = Mid(pos, end - pos);
+  Consume(end + 1);
+  return SCAN_RECORD;
+}
+
+bool OutputScanner::SkipTo(const wxString &token, long *skipped)
+{
+  int pos = Find(token);
+  bool found = (pos > -1);
+
+  // Keep the end which could be the beginning of token
+  if (!found) {
+    pos = Length() - token.Length() + 1;
+    if (pos < 0)
+      pos = 0;
+  }
+
+  *skipped += pos;
+  Consume(pos);
+  return found;
+}
+
+void OutputScanner::Erase(int start, int length)
+{
+  size_t from = m_start + start;
+  m_text.erase(from, length);
+
+  // Tokens can now span the place where text was removed
+  for (ScanPositions::iterator it = m_scanned.begin(); it != m_scanned.end(); ++it)
+  {
+    size_t back = it->first.Length();
+    size_t limit = from > back ? from - back : 0;
+    if (it->second > limit)
+      it->second = limit;
+  }
+}
+
+void OutputScanner::Clear()
+{
+  m_text = wxEmptyString;
+  m_scanned.clear();
+  m_start = 0;
+  m_partialLength = 0;
+}
+
+/***
+ * Drops the consumed text from the front of the buffer. Called only
+ * when at least half of the buffer has been consumed, so the cost of
+ * moving the text is linear in the size of the output.
+ */
+void OutputScanner::Compact()
+{
+  m_text = m_text.Mid(m_start);
+
+  for (ScanPositions::iterator it = m_scanned.begin(); it != m_scanned.end(); ++it)
+  {
+    if (it->second > m_start)
+      it->second -= m_start;
+    else
+      it->second = 0;
+  }
+
+  m_start = 0;
+}
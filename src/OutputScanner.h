@@ -0,0 +1,77 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#ifndef _OUTPUTSCANNER_H_
+#define _OUTPUTSCANNER_H_
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <wx/hashmap.h>
+
+WX_DECLARE_STRING_HASH_MAP(size_t, ScanPositions);
+
+// Buffer for the text maxima writes to the socket.
+//
+// Chunks read from the socket are appended with Append. Bytes of an
+// UTF-8 sequence which is split between two chunks are kept until the
+// rest of the sequence arrives. Find remembers for each token how far
+// the buffer has already been searched, so that each character is
+// examined only once per token no matter how many chunks it takes
+// before the token arrives. Consumed text is dropped from the front
+// of the buffer lazily.
+class OutputScanner
+{
+public:
+  OutputScanner();
+  ~OutputScanner() {};
+  void Append(const char *data, size_t length);
+  // Position of token in the unconsumed text, or -1.
+  int Find(const wxString &token);
+  wxString Mid(int start, int length);
+  wxString Left(int length) { return Mid(0, length); }
+  wxChar GetChar(int i) { return m_text[m_start + i]; }
+  wxString GetText() { return m_text.Mid(m_start); }
+  // Removes the first length characters.
+  void Consume(int length);
+  // Removes length characters starting at start.
+  void Erase(int start, int length);
+  void Clear();
+  int Length() { return m_text.Length() - m_start; }
+  // Reads the next piece of framed output, see NextRecord.
+  enum {
+    SCAN_WAIT,  // nothing complete yet
+    SCAN_TEXT,  // text outside of records
+    SCAN_RECORD // a record
+  };
+  int NextRecord(wxChar *type, wxString *data);
+  // Drops the text before token without looking at it; returns true
+  // if token was found. skipped is increased by the length dropped.
+  bool SkipTo(const wxString &token, long *skipped);
+  bool IsEmpty() { return Length() == 0; }
+private:
+  static size_t CompleteUTF8Length(const char *data, size_t length);
+  void Compact();
+  wxString m_text;
+  size_t m_start;
+  ScanPositions m_scanned;
+  char m_partial[4];
+  size_t m_partialLength;
+};
+
+#endif // _OUTPUTSCANNER_H_
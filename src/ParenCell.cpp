@@ -135,11 +135,11 @@ void ParenCell::RecalculateWidths(CellParser& parser, int fontsize, bool all)
       m_parenFontSize = fontsize;
       fontsize1 = (int) ((m_parenFontSize * scale + 0.5));
 
-      dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                        false, false, false,
-                        m_bigParenType == 0 ?
-                          parser.GetTeXCMRI() :
-                            parser.GetTeXCMEX()));
+      dc.SetFont(CellParser::GetFont(fontsize1,
+                                     false, false, false,
+                                     m_bigParenType == 0 ?
+                                       parser.GetTeXCMRI() :
+                                         parser.GetTeXCMEX()));
       dc.GetTextExtent(m_bigParenType == 0 ? wxT("(") :
                        m_bigParenType == 1 ? wxT(PAREN_OPEN) :
                                              wxT(PAREN_OPEN_TOP),
@@ -152,11 +152,11 @@ void ParenCell::RecalculateWidths(CellParser& parser, int fontsize, bool all)
       while (m_signSize < TRANSFORM_SIZE(m_bigParenType, size) && i<20)
       {
         int fontsize1 = (int) ((m_parenFontSize++ * scale + 0.5));
-        dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                          false, false, false,
-                          m_bigParenType == 0 ?
-                             parser.GetTeXCMRI() :
-                               parser.GetTeXCMEX()));
+        dc.SetFont(CellParser::GetFont(fontsize1,
+                                       false, false, false,
+                                       m_bigParenType == 0 ?
+                                          parser.GetTeXCMRI() :
+                                            parser.GetTeXCMEX()));
         dc.GetTextExtent(m_bigParenType == 0 ? wxT("(") :
                          m_bigParenType == 1 ? wxT(PAREN_OPEN) :
                                                wxT(PAREN_OPEN_TOP),
@@ -168,11 +168,11 @@ void ParenCell::RecalculateWidths(CellParser& parser, int fontsize, bool all)
     {
       m_parenFontSize = fontsize;
       fontsize1 = (int) ((m_parenFontSize * scale + 0.5));
-      dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                        false, false, false,
-                        m_bigParenType < 1 ?
-                          parser.GetTeXCMRI() :
-                            parser.GetTeXCMEX()));
+      dc.SetFont(CellParser::GetFont(fontsize1,
+                                     false, false, false,
+                                     m_bigParenType < 1 ?
+                                       parser.GetTeXCMRI() :
+                                         parser.GetTeXCMEX()));
       dc.GetTextExtent(wxT(PAREN_OPEN), &m_signWidth, &m_signSize);
     }
 
@@ -184,11 +184,11 @@ void ParenCell::RecalculateWidths(CellParser& parser, int fontsize, bool all)
 #if defined __WXMSW__
     wxDC& dc = parser.GetDC();
     int fontsize1 = (int) ((PAREN_FONT_SIZE * scale + 0.5));
-    dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                      parser.IsItalic(TS_DEFAULT),
-                      parser.IsBold(TS_DEFAULT),
-                      parser.IsUnderlined(TS_DEFAULT),
-                      parser.GetSymbolFontName()));
+    dc.SetFont(CellParser::GetFont(fontsize1,
+                                   parser.IsItalic(TS_DEFAULT),
+                                   parser.IsBold(TS_DEFAULT),
+                                   parser.IsUnderlined(TS_DEFAULT),
+                                   parser.GetSymbolFontName()));
     dc.GetTextExtent(wxT(PAREN_LEFT_TOP), &m_charWidth, &m_charHeight);
     m_width = m_innerCell->GetFullWidth(scale) + 2*m_charWidth;
 #else
@@ -213,11 +213,11 @@ void ParenCell::RecalculateSize(CellParser& parser, int fontsize, bool all)
   {
     wxDC& dc = parser.GetDC();
     int fontsize1 = (int) ((fontsize * scale + 0.5));
-    dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                      false,
-                      false,
-                      false,
-                      parser.GetFontName()));
+    dc.SetFont(CellParser::GetFont(fontsize1,
+                                   false,
+                                   false,
+                                   false,
+                                   parser.GetFontName()));
     dc.GetTextExtent(wxT("("), &m_charWidth1, &m_charHeight1);
   }
 #endif
@@ -240,11 +240,11 @@ void ParenCell::Draw(CellParser& parser, wxPoint point, int fontsize, bool all)
       in.x = point.x + m_signWidth;
       SetForeground(parser);
       int fontsize1 = (int) ((m_parenFontSize * scale + 0.5));
-      dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                        false, false, false,
-                        m_bigParenType < 1 ?
-                          parser.GetTeXCMRI() :
-                            parser.GetTeXCMEX()));
+      dc.SetFont(CellParser::GetFont(fontsize1,
+                                     false, false, false,
+                                     m_bigParenType < 1 ?
+                                       parser.GetTeXCMRI() :
+                                         parser.GetTeXCMEX()));
       if (m_bigParenType < 2)
       {
         dc.DrawText(m_bigParenType == 0 ? wxT("(") :
@@ -298,11 +298,11 @@ void ParenCell::Draw(CellParser& parser, wxPoint point, int fontsize, bool all)
       if (m_height < (3*m_charHeight)/2)
       {
         fontsize1 = (int) ((fontsize * scale + 0.5));
-        dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                          false,
-                          false,
-                          false,
-                          parser.GetFontName()));
+        dc.SetFont(CellParser::GetFont(fontsize1,
+                                       false,
+                                       false,
+                                       false,
+                                       parser.GetFontName()));
         dc.DrawText(wxT("("),
                     point.x + m_charWidth - m_charWidth1,
                     point.y - m_charHeight1 / 2);
@@ -312,11 +312,11 @@ void ParenCell::Draw(CellParser& parser, wxPoint point, int fontsize, bool all)
       }
       else
       {
-        dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                          false,
-                          false,
-                          false,
-                          parser.GetSymbolFontName()));
+        dc.SetFont(CellParser::GetFont(fontsize1,
+                                       false,
+                                       false,
+                                       false,
+                                       parser.GetSymbolFontName()));
         dc.DrawText(wxT(PAREN_LEFT_TOP),
                     point.x,
                     point.y - m_center);
@@ -0,0 +1,316 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#include "ParserThread.h"
+
+#include <wx/tokenzr.h>
+
+ParserJob::ParserJob(int kind, wxString text, int type)
+{
+  m_kind = kind;
+  m_type = type;
+  // Make sure the text shares no data with strings in the GUI thread
+  m_text = wxString(text.c_str());
+  m_parsed = false;
+  m_cancelled = false;
+  next = NULL;
+}
+
+ParserJob::~ParserJob()
+{
+  for (unsigned int i = 0; i < m_cells.size(); i++)
+    if (m_cells[i] != NULL)
+      delete m_cells[i];
+}
+
+bool ParserJob::CanParseInThread()
+{
+  // Images are loaded into wxBitmaps, which can only be done in the GUI thread.
+  return m_kind == JOB_OUTPUT &&
+         m_text.Find(wxT("<img")) == -1 &&
+         m_text.Find(wxT("<slide")) == -1;
+}
+
+MathCell* ParserJob::TakeLine(int i, bool *newLine)
+{
+  MathCell *cell = m_cells[i];
+  *newLine = m_newLines[i];
+  m_cells[i] = NULL;
+  return cell;
+}
+
+void ParserJob::AddLine(MathCell *cell, bool newLine)
+{
+  m_cells.push_back(cell);
+  m_newLines.push_back(cell != NULL && (newLine || cell->BreakLineHere()));
+}
+
+void ParserJob::AddRawLine(wxString s, int type)
+{
+  MathCell *cell = RawCells(s, type);
+  if (cell != NULL)
+    AddLine(cell, true);
+}
+
+/***
+ * Creates the cells for the output in the same way as
+ * wxMaxima::ConsoleAppend did when it inserted them directly.
+ */
+void ParserJob::Parse(MathParser& parser)
+{
+  m_parsed = true;
+  if (m_kind != JOB_OUTPUT || m_cancelled)
+    return;
+
+  wxString s = m_text;
+  wxString t;
+
+  if (m_type == MC_TYPE_DEFAULT)
+  {
+    while (s.Length() > 0)
+    {
+      int start = s.Find(wxT("<mth"));
+
+      if (start == -1) {
+        t = s;
+        t.Trim();
+        t.Trim(false);
+        if (t.Length())
+          AddRawLine(s, MC_TYPE_DEFAULT);
+        s = wxEmptyString;
+      }
+
+      else {
+        wxString pre = s.SubString(0, start - 1);
+        wxString pre1(pre);
+        pre1.Trim();
+        pre1.Trim(false);
+        int end = s.Find(wxT("</mth>"));
+        if (end == -1)
+          end = s.Length();
+        else
+          end += 5;
+        wxString rest = s.SubString(start, end);
+
+        if (pre1.Length())
+          AddRawLine(pre, MC_TYPE_DEFAULT);
+        AddLine(ParseXml(parser, wxT("<span>") + rest + wxT("</span>"), m_type), false);
+        s = s.SubString(end + 1, s.Length());
+      }
+    }
+  }
+
+  else if (m_type == MC_TYPE_PROMPT) {
+    if (s.StartsWith(wxT("MAXIMA> "))) {
+      s = s.Right(8);
+    }
+    else
+      s = s + wxT(" ");
+
+    AddLine(ParseXml(parser, wxT("<span>") + s + wxT("</span>"), m_type), true);
+  }
+
+  else if (m_type == MC_TYPE_ERROR)
+    AddRawLine(s, MC_TYPE_ERROR);
+
+  else
+    AddLine(ParseXml(parser, wxT("<span>") + s + wxT("</span>"), m_type), false);
+}
+
+MathCell* ParserJob::ParseXml(MathParser& parser, wxString s, int type, bool bigSkip)
+{
+  s.Replace(wxT("\n"), wxT(""), true);
+
+  MathCell *cell = parser.ParseLine(s, type);
+
+  if (cell != NULL)
+    cell->SetSkip(bigSkip);
+
+  return cell;
+}
+
+MathCell* ParserJob::RawCells(wxString s, int type)
+{
+  if (type == MC_TYPE_MAIN_PROMPT)
+  {
+    TextCell* cell = new TextCell(s);
+    cell->SetType(type);
+    return cell;
+  }
+
+  wxStringTokenizer tokens(s, wxT("\n"));
+  MathCell *tmp = NULL, *lst = NULL;
+  while (tokens.HasMoreTokens())
+  {
+    TextCell* cell = new TextCell(tokens.GetNextToken());
+
+    cell->SetType(type);
+
+    if (tokens.HasMoreTokens())
+      cell->SetSkip(false);
+
+    if (lst == NULL)
+      tmp = lst = cell;
+    else {
+      lst->AppendCell(cell);
+      cell->ForceBreakLine(true);
+      lst = cell;
+    }
+  }
+  return tmp;
+}
+
+ParserThread::ParserThread(wxEvtHandler *handler, int id) :
+  wxThread(wxTHREAD_JOINABLE),
+  m_condition(m_mutex)
+{
+  m_handler = handler;
+  m_id = id;
+  m_stop = false;
+  m_jobs = m_lastJob = NULL;
+  m_finished = m_lastFinished = NULL;
+}
+
+ParserThread::~ParserThread()
+{
+  while (m_jobs != NULL)
+  {
+    ParserJob *job = m_jobs;
+    m_jobs = job->next;
+    delete job;
+  }
+  while (m_finished != NULL)
+  {
+    ParserJob *job = m_finished;
+    m_finished = job->next;
+    delete job;
+  }
+}
+
+void ParserThread::AddJob(ParserJob *job)
+{
+  wxMutexLocker lock(m_mutex);
+
+  job->next = NULL;
+  if (m_lastJob == NULL)
+    m_jobs = m_lastJob = job;
+  else {
+    m_lastJob->next = job;
+    m_lastJob = job;
+  }
+
+  m_condition.Signal();
+}
+
+ParserJob* ParserThread::GetFinishedJob()
+{
+  wxMutexLocker lock(m_mutex);
+
+  ParserJob *job = m_finished;
+  if (job != NULL)
+  {
+    m_finished = job->next;
+    if (m_finished == NULL)
+      m_lastFinished = NULL;
+    job->next = NULL;
+  }
+
+  return job;
+}
+
+void ParserThread::ReadConfig()
+{
+  wxMutexLocker lock(m_parserMutex);
+  m_parser.ReadConfig();
+}
+
+/***
+ * Cancels the output jobs after the last prompt, which is the output
+ * of the command maxima is evaluating now.
+ */
+void ParserThread::CancelOutput()
+{
+  wxMutexLocker lock(m_mutex);
+
+  std::vector<ParserJob*> jobs;
+  for (ParserJob *job = m_finished; job != NULL; job = job->next)
+    jobs.push_back(job);
+  for (ParserJob *job = m_jobs; job != NULL; job = job->next)
+    jobs.push_back(job);
+
+  for (int i = jobs.size() - 1; i >= 0; i--)
+  {
+    if (jobs[i]->GetKind() == ParserJob::JOB_PROMPT)
+      break;
+    jobs[i]->Cancel();
+  }
+}
+
+void ParserThread::Stop()
+{
+  {
+    wxMutexLocker lock(m_mutex);
+    m_stop = true;
+    m_condition.Signal();
+  }
+  Wait();
+}
+
+wxThread::ExitCode ParserThread::Entry()
+{
+  while (true)
+  {
+    ParserJob *job;
+
+    {
+      wxMutexLocker lock(m_mutex);
+      while (m_jobs == NULL && !m_stop)
+        m_condition.Wait();
+      if (m_jobs == NULL)
+        break;
+
+      job = m_jobs;
+      m_jobs = job->next;
+      if (m_jobs == NULL)
+        m_lastJob = NULL;
+      job->next = NULL;
+    }
+
+    if (job->CanParseInThread())
+    {
+      wxMutexLocker lock(m_parserMutex);
+      job->Parse(m_parser);
+    }
+
+    {
+      wxMutexLocker lock(m_mutex);
+      if (m_lastFinished == NULL)
+        m_finished = m_lastFinished = job;
+      else {
+        m_lastFinished->next = job;
+        m_lastFinished = job;
+      }
+    }
+
+    wxCommandEvent event(wxEVT_COMMAND_MENU_SELECTED, m_id);
+    wxPostEvent(m_handler, event);
+  }
+
+  return 0;
+}
@@ -0,0 +1,96 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#ifndef _PARSERTHREAD_H_
+#define _PARSERTHREAD_H_
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+
+#include <vector>
+
+#include "MathParser.h"
+
+// A piece of maxima output on its way to the document. Jobs are handed
+// to the document in the order in which they were created, no matter
+// if they were parsed in the ParserThread or not.
+class ParserJob
+{
+public:
+  enum {
+    JOB_OUTPUT, // output which is parsed into cells
+    JOB_PROMPT  // a prompt; wxMaxima handles it when the output before it is in the document
+  };
+  ParserJob(int kind, wxString text, int type = MC_TYPE_DEFAULT);
+  ~ParserJob();
+  void Parse(MathParser& parser);
+  bool IsParsed() { return m_parsed; }
+  void Cancel() { m_cancelled = true; }
+  bool IsCancelled() { return m_cancelled; }
+  bool CanParseInThread();
+  int GetKind() { return m_kind; }
+  wxString GetText() { return m_text; }
+  int GetLineCount() { return m_cells.size(); }
+  // Returns the i-th line and passes its ownership to the caller.
+  // NULL means there was an error in the xml.
+  MathCell* TakeLine(int i, bool *newLine);
+  static MathCell* ParseXml(MathParser& parser, wxString s, int type, bool bigSkip = true);
+  static MathCell* RawCells(wxString s, int type);
+  ParserJob* next;
+private:
+  void AddLine(MathCell *cell, bool newLine);
+  void AddRawLine(wxString s, int type);
+  int m_kind;
+  int m_type;
+  wxString m_text;
+  bool m_parsed;
+  bool m_cancelled;
+  std::vector<MathCell*> m_cells;
+  std::vector<bool> m_newLines;
+};
+
+// Parses the maxima output outside of the GUI thread. When a job is
+// done the handler gets a menu event with the given id and collects
+// the finished jobs with GetFinishedJob. Stop waits until all jobs
+// which were added are finished. Cancelled jobs are not parsed.
+class ParserThread : public wxThread
+{
+public:
+  ParserThread(wxEvtHandler *handler, int id);
+  ~ParserThread();
+  void AddJob(ParserJob *job);
+  ParserJob* GetFinishedJob();
+  void Stop();
+  void ReadConfig();
+  void CancelOutput();
+protected:
+  ExitCode Entry();
+private:
+  MathParser m_parser;
+  wxEvtHandler *m_handler;
+  int m_id;
+  wxMutex m_mutex;
+  wxMutex m_parserMutex;
+  wxCondition m_condition;
+  bool m_stop;
+  ParserJob *m_jobs, *m_lastJob;
+  ParserJob *m_finished, *m_lastFinished;
+};
+
+#endif // _PARSERTHREAD_H_
@@ -0,0 +1,256 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#include "ResultCache.h"
+#include "EditorCell.h"
+
+#include <wx/config.h>
+
+ResultCache::ResultCache()
+{
+  m_interrupted = 0;
+  ReadConfig();
+}
+
+ResultCache::~ResultCache()
+{
+  Clear();
+}
+
+void ResultCache::ReadConfig()
+{
+  m_enabled = false;
+  wxConfig::Get()->Read(wxT("cacheResults"), &m_enabled);
+  if (!m_enabled)
+    Clear();
+}
+
+void ResultCache::DestroyList(MathCell *cell)
+{
+  while (cell != NULL) {
+    MathCell *tmp = cell;
+    cell = cell->m_next;
+    tmp->Destroy();
+    delete tmp;
+  }
+}
+
+void ResultCache::Clear()
+{
+  for (CachedResults::iterator it = m_results.begin(); it != m_results.end(); ++it)
+    DestroyList(it->second);
+  m_results.clear();
+  m_used.Clear();
+  m_keys.clear();
+}
+
+/***
+ * Moves key to the end of m_used.
+ */
+void ResultCache::Used(const wxString &key)
+{
+  int index = m_used.Index(key);
+  if (index != wxNOT_FOUND)
+    m_used.RemoveAt(index);
+  m_used.Add(key);
+  Evict();
+}
+
+/***
+ * Drops the outputs which were not used for the longest time when
+ * there are too many.
+ */
+void ResultCache::Evict()
+{
+  while (m_used.GetCount() > RESULT_CACHE_SIZE)
+  {
+    CachedResults::iterator old = m_results.find(m_used[0]);
+    if (old != m_results.end()) {
+      DestroyList(old->second);
+      m_results.erase(old);
+    }
+    m_used.RemoveAt(0);
+  }
+}
+
+/***
+ * Two 32 bit FNV-1a hashes with different offsets, as a string.
+ */
+wxString ResultCache::Hash(const wxString &s)
+{
+  wxUint32 h1 = 2166136261u, h2 = 84696351u;
+
+  for (size_t i = 0; i < s.Length(); i++)
+  {
+    wxUint32 c = (wxUint32)s[i];
+    h1 = (h1 ^ c) * 16777619u;
+    h2 = (h2 ^ c) * 16777619u;
+  }
+
+  return wxString::Format(wxT("%08x%08x"), h1, h2);
+}
+
+void ResultCache::Reset()
+{
+  m_chain = wxEmptyString;
+  m_keys.clear();
+}
+
+wxString ResultCache::GetChain()
+{
+  if (m_chain.IsEmpty())
+    return Hash(m_version);
+  return m_chain;
+}
+
+wxString ResultCache::GetInput(GroupCell *group)
+{
+  // The ending is added when the cell is evaluated
+  wxString input = group->GetEditable()->GetValue();
+  input.Trim();
+  if (!input.StartsWith(wxT(":lisp")) &&
+      !input.EndsWith(wxT(";")) && !input.EndsWith(wxT("$")))
+    input += wxT(";");
+  return input;
+}
+
+/***
+ * The key of group if it is the next cell sent to maxima.
+ */
+wxString ResultCache::GetKey(GroupCell *group)
+{
+  return Hash(GetChain() + GetInput(group));
+}
+
+void ResultCache::Sent(GroupCell *group)
+{
+  m_chain = GetKey(group);
+  m_keys[group] = m_chain;
+}
+
+void ResultCache::Sent(wxString input)
+{
+  m_chain = Hash(GetChain() + input);
+}
+
+/***
+ * Nothing evaluated after an interrupt can be taken from the cache
+ * later, so the chain gets a mark which is never repeated.
+ */
+void ResultCache::Interrupted(GroupCell *group)
+{
+  Forget(group);
+  m_interrupted++;
+  Sent(wxString::Format(wxT("\x01interrupted %d"), m_interrupted));
+}
+
+void ResultCache::Rewind(GroupCell *group)
+{
+  CacheKeys::iterator key = m_keys.find(group);
+  if (key != m_keys.end())
+    m_chain = key->second;
+}
+
+void ResultCache::Forget(GroupCell *group)
+{
+  m_keys.erase(group);
+}
+
+void ResultCache::Store(GroupCell *group)
+{
+  CacheKeys::iterator key = m_keys.find(group);
+  if (key == m_keys.end())
+    return;
+
+  wxString k = key->second;
+  m_keys.erase(key);
+  if (!m_enabled || group->GetLabel() == NULL)
+    return;
+
+  CachedResults::iterator old = m_results.find(k);
+  if (old != m_results.end())
+    DestroyList(old->second);
+
+  m_results[k] = group->GetLabel()->Copy(true);
+  Used(k);
+}
+
+bool ResultCache::Has(GroupCell *group)
+{
+  if (!m_enabled)
+    return false;
+
+  return m_results.find(GetKey(group)) != m_results.end();
+}
+
+MathCell *ResultCache::Get(GroupCell *group)
+{
+  if (!Has(group))
+    return NULL;
+
+  wxString key = GetKey(group);
+  Used(key);
+  return m_results[key]->Copy(true);
+}
+
+wxString ResultCache::ToXML()
+{
+  if (!m_enabled || m_used.IsEmpty())
+    return wxEmptyString;
+
+  wxString xml = wxT("\n<cache>");
+  for (unsigned int i = 0; i < m_used.GetCount(); i++)
+    xml += wxT("\n<entry key=\"") + m_used[i] + wxT("\"><mth>") +
+           m_results[m_used[i]]->ToXML(true) + wxT("</mth></entry>");
+  xml += wxT("\n</cache>");
+  return xml;
+}
+
+void ResultCache::Load(wxXmlNode *node, MathParser &parser)
+{
+  if (!m_enabled || node == NULL || node->GetName() != wxT("cache"))
+    return;
+
+  unsigned int loaded = 0;
+  for (wxXmlNode *entry = node->GetChildren(); entry != NULL; entry = entry->GetNext())
+  {
+    if (entry->GetName() != wxT("entry"))
+      continue;
+
+#if wxCHECK_VERSION(2,9,0)
+    wxString key = entry->GetAttribute(wxT("key"), wxEmptyString);
+#else
+    wxString key = entry->GetPropVal(wxT("key"), wxEmptyString);
+#endif
+    // Outputs of this session are newer
+    if (key.IsEmpty() || m_results.find(key) != m_results.end())
+      continue;
+
+    MathCell *output = parser.ParseTag(entry->GetChildren());
+    if (output == NULL)
+      continue;
+
+    // The entries are saved the last used last, and before the
+    // outputs of this session
+    m_results[key] = output;
+    m_used.Insert(key, loaded++);
+  }
+
+  Evict();
+}
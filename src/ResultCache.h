@@ -0,0 +1,102 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#ifndef _RESULTCACHE_H_
+#define _RESULTCACHE_H_
+
+#include <wx/wx.h>
+#include <wx/string.h>
+#include <wx/hashmap.h>
+#include <wx/xml/xml.h>
+
+#include "GroupCell.h"
+#include "MathParser.h"
+
+// The number of outputs which are kept
+#define RESULT_CACHE_SIZE 200
+
+WX_DECLARE_STRING_HASH_MAP(MathCell*, CachedResults);
+WX_DECLARE_VOIDPTR_HASH_MAP(wxString, CacheKeys);
+
+// Keeps the output of evaluated cells, so that cells don't have to be
+// evaluated again if maxima would evaluate them in the same state.
+//
+// The key of a cell is a hash of the maxima version, the inputs which
+// were sent to maxima since it was started, or which are owed to it
+// (see wxMaxima::TakeFromCache), and the input of the cell. Sent adds
+// an input to this chain and Reset starts a new chain when maxima is
+// restarted. The chain is kept even when the cache is disabled, so
+// that it is right when the cache is enabled.
+//
+// Only the RESULT_CACHE_SIZE outputs which were used last are kept.
+// The cache is saved in wxmx documents, so the cells of a document
+// which is opened again can be taken from it when maxima gets the same
+// inputs after it is started.
+class ResultCache
+{
+public:
+  ResultCache();
+  ~ResultCache();
+  void ReadConfig();
+  bool IsEnabled() { return m_enabled; }
+  void SetVersion(wxString version) { m_version = version; }
+  // Maxima was started, nothing was sent to it yet.
+  void Reset();
+  // The input of the cell was sent to maxima or is owed to it.
+  void Sent(GroupCell *group);
+  // Other input, like the answer to a question, was sent to maxima.
+  void Sent(wxString input);
+  // Maxima dropped the inputs sent after the input of the cell, they
+  // are sent again.
+  void Rewind(GroupCell *group);
+  // The evaluation of the cell was interrupted. Its output is not
+  // stored and the state of maxima can't be reproduced.
+  void Interrupted(GroupCell *group);
+  // The output of the cell is not stored.
+  void Forget(GroupCell *group);
+  // Stores a copy of the output of the cell.
+  void Store(GroupCell *group);
+  // Is there an output for the cell if it is sent next?
+  bool Has(GroupCell *group);
+  // Returns a copy of the output stored for the cell, or NULL.
+  MathCell *Get(GroupCell *group);
+  void Clear();
+  // The cache as xml for a wxmx document. Images are added to the
+  // memory file system like the images of the document.
+  wxString ToXML();
+  // Adds the outputs in the cache tag of a wxmx document.
+  void Load(wxXmlNode *node, MathParser &parser);
+  static wxString Hash(const wxString &s);
+private:
+  static void DestroyList(MathCell *cell);
+  void Used(const wxString &key);
+  void Evict();
+  static wxString GetInput(GroupCell *group);
+  wxString GetKey(GroupCell *group);
+  wxString GetChain();
+  bool m_enabled;
+  CachedResults m_results;
+  wxArrayString m_used;  // the keys of m_results, the last used last
+  CacheKeys m_keys;
+  wxString m_version;
+  wxString m_chain;
+  int m_interrupted;
+};
+
+#endif // _RESULTCACHE_H_
@@ -0,0 +1,168 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+
+#include "SendQueue.h"
+
+#include <string.h>
+
+StreamWriter::StreamWriter(wxOutputStream *stream) :
+  wxThread(wxTHREAD_JOINABLE),
+  m_condition(m_mutex)
+{
+  m_stream = stream;
+  m_stop = false;
+}
+
+void StreamWriter::Add(const char *data, size_t length)
+{
+  wxMutexLocker lock(m_mutex);
+  m_data.AppendData((void *)data, length);
+  m_condition.Signal();
+}
+
+void StreamWriter::Stop()
+{
+  {
+    wxMutexLocker lock(m_mutex);
+    m_stop = true;
+    m_condition.Signal();
+  }
+  Wait();
+}
+
+wxThread::ExitCode StreamWriter::Entry()
+{
+  wxMemoryBuffer data;
+
+  while (true)
+  {
+    {
+      wxMutexLocker lock(m_mutex);
+      while (m_data.GetDataLen() == 0 && !m_stop)
+        m_condition.Wait();
+      if (m_stop)
+        break;
+
+      data.SetDataLen(0);
+      data.AppendData(m_data.GetData(), m_data.GetDataLen());
+      m_data.SetDataLen(0);
+    }
+
+    // A pipe may take only a part of the text at once
+    char *p = (char *)data.GetData();
+    size_t length = data.GetDataLen();
+    while (length > 0)
+    {
+      m_stream->Write(p, length);
+      size_t written = m_stream->LastWrite();
+      if (written == 0)
+        return 0; // maxima is gone
+      p += written;
+      length -= written;
+    }
+  }
+
+  return 0;
+}
+
+SendQueue::SendQueue()
+{
+  m_socket = NULL;
+  m_writer = NULL;
+  m_written = 0;
+}
+
+SendQueue::~SendQueue()
+{
+  SetStream(NULL);
+}
+
+void SendQueue::SetSocket(wxSocketBase *socket)
+{
+  SetStream(NULL);
+  m_socket = socket;
+  m_data.SetDataLen(0);
+  m_written = 0;
+}
+
+void SendQueue::SetStream(wxOutputStream *stream)
+{
+  if (m_writer != NULL) {
+    m_writer->Stop();
+    delete m_writer;
+    m_writer = NULL;
+  }
+
+  m_socket = NULL;
+  m_data.SetDataLen(0);
+  m_written = 0;
+
+  if (stream == NULL)
+    return;
+
+  m_writer = new StreamWriter(stream);
+  if (m_writer->Create() != wxTHREAD_NO_ERROR ||
+      m_writer->Run() != wxTHREAD_NO_ERROR)
+  {
+    delete m_writer;
+    m_writer = NULL;
+  }
+}
+
+void SendQueue::Write(const char *data, size_t length)
+{
+  if (m_writer != NULL) {
+    m_writer->Add(data, length);
+    return;
+  }
+
+  if (m_socket == NULL)
+    return;
+
+  m_data.AppendData((void *)data, length);
+  Flush();
+}
+
+void SendQueue::Flush()
+{
+  if (m_socket == NULL || GetLength() == 0)
+    return;
+
+  // Write only what the socket takes without waiting. The flags are
+  // restored because reading from the socket relies on them.
+  wxSocketFlags flags = m_socket->GetFlags();
+  m_socket->SetFlags(wxSOCKET_NOWAIT);
+  m_socket->Write((char *)m_data.GetData() + m_written, GetLength());
+  m_written += m_socket->LastCount();
+  m_socket->SetFlags(flags);
+
+  if (GetLength() == 0) {
+    m_data.SetDataLen(0);
+    m_written = 0;
+  }
+
+  // Don't let the buffer grow while maxima reads slower than we write
+  else if (m_written > m_data.GetDataLen() / 2) {
+    size_t rest = GetLength();
+    memmove(m_data.GetData(), (char *)m_data.GetData() + m_written, rest);
+    m_data.SetDataLen(rest);
+    m_written = 0;
+  }
+}
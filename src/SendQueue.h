@@ -0,0 +1,77 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+
+#ifndef _SENDQUEUE_H_
+#define _SENDQUEUE_H_
+
+#include <wx/wx.h>
+#include <wx/socket.h>
+#include <wx/stream.h>
+#include <wx/buffer.h>
+#include <wx/thread.h>
+
+// Writes to a stream outside of the GUI thread. A pipe has no event
+// which tells when it can take more, so the thread waits in Write
+// instead. Stop waits until the thread is done; the text which was not
+// written is dropped.
+class StreamWriter : public wxThread
+{
+public:
+  StreamWriter(wxOutputStream *stream);
+  void Add(const char *data, size_t length);
+  void Stop();
+protected:
+  ExitCode Entry();
+private:
+  wxOutputStream *m_stream;
+  wxMutex m_mutex;
+  wxCondition m_condition;
+  bool m_stop;
+  wxMemoryBuffer m_data;
+};
+
+// Text on its way to maxima. Write never blocks: what the socket
+// doesn't take at once is kept and written by Flush when the socket
+// reports wxSOCKET_OUTPUT, so a long input doesn't stop the GUI until
+// maxima has read all of it.
+//
+// A stream (the standard input of maxima) is written by a StreamWriter.
+class SendQueue
+{
+public:
+  SendQueue();
+  ~SendQueue();
+  // Drops the queued text; it was meant for the previous socket.
+  void SetSocket(wxSocketBase *socket);
+  // Stops writing to the previous stream. Returns when nothing writes
+  // to it any more.
+  void SetStream(wxOutputStream *stream);
+  void Write(const char *data, size_t length);
+  void Flush();
+  // Bytes which are still waiting to be written.
+  size_t GetLength() { return m_data.GetDataLen() - m_written; }
+private:
+  wxSocketBase *m_socket;
+  StreamWriter *m_writer;
+  wxMemoryBuffer m_data;
+  size_t m_written;
+};
+
+#endif // _SENDQUEUE_H_
@@ -0,0 +1,234 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+
+#include "SessionLog.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SESSION_HEADER "wxMaxima session 1\n"
+
+bool SessionRecorder::Open(wxString file)
+{
+  Close();
+  if (!m_file.Open(file, wxT("wb")))
+    return false;
+  m_file.Write(SESSION_HEADER, strlen(SESSION_HEADER));
+  m_time.Start();
+  return true;
+}
+
+void SessionRecorder::Close()
+{
+  if (m_file.IsOpened())
+    m_file.Close();
+}
+
+void SessionRecorder::Write(char direction, const char *data, size_t length)
+{
+  if (!m_file.IsOpened() || length == 0)
+    return;
+
+  char header[64];
+  sprintf(header, "%c %ld %lu\n", direction, m_time.Time(), (unsigned long)length);
+  m_file.Write(header, strlen(header));
+  m_file.Write(data, length);
+  m_file.Write("\n", 1);
+}
+
+SessionReplay::SessionReplay(bool fast)
+{
+  m_fast = fast;
+  m_socket = NULL;
+  m_next = m_written = m_expected = m_received = 0;
+  m_waited = false;
+  m_timer.SetOwner(this, session_timer_id);
+}
+
+SessionReplay::~SessionReplay()
+{
+  Stop();
+}
+
+/***
+ * Reads the records of a session file. Returns false if the file can't
+ * be read or is not a session file.
+ */
+bool SessionReplay::Load(wxString file)
+{
+  wxFFile input;
+  if (!input.Open(file, wxT("rb")))
+    return false;
+
+  std::string text;
+  char buffer[65536];
+  size_t read;
+  while ((read = input.Read(buffer, sizeof(buffer))) > 0)
+    text.append(buffer, read);
+  input.Close();
+
+  size_t pos = strlen(SESSION_HEADER);
+  if (text.compare(0, pos, SESSION_HEADER) != 0)
+    return false;
+
+  m_records.clear();
+  while (pos < text.length())
+  {
+    size_t end = text.find('\n', pos);
+    if (end == std::string::npos)
+      return false;
+
+    SessionRecord record;
+    unsigned long length;
+    if (sscanf(text.substr(pos, end - pos).c_str(), "%c %ld %lu",
+               &record.direction, &record.time, &length) != 3 ||
+        end + 1 + length > text.length())
+      return false;
+
+    record.data = text.substr(end + 1, length);
+    m_records.push_back(record);
+    pos = end + 1 + length + 1;
+  }
+
+  return true;
+}
+
+/***
+ * Connects to the server of wxMaxima on port and starts the replay
+ * from the beginning.
+ */
+bool SessionReplay::Start(int port)
+{
+  Stop();
+
+  m_next = m_written = m_expected = m_received = 0;
+  m_waited = false;
+
+  wxIPV4address address;
+  address.Hostname(wxT("localhost"));
+  address.Service(port);
+
+  m_socket = new wxSocketClient(wxSOCKET_NOWAIT);
+  m_socket->SetEventHandler(*this, session_socket_id);
+  m_socket->SetNotify(wxSOCKET_INPUT_FLAG | wxSOCKET_OUTPUT_FLAG | wxSOCKET_LOST_FLAG);
+  m_socket->Notify(true);
+
+  if (!m_socket->Connect(address, true))
+  {
+    Stop();
+    return false;
+  }
+
+  Step();
+  return true;
+}
+
+void SessionReplay::Stop()
+{
+  m_timer.Stop();
+  if (m_socket != NULL)
+  {
+    m_socket->Notify(false);
+    m_socket->Destroy();
+  }
+  m_socket = NULL;
+}
+
+/***
+ * Sends the records which can be sent now.
+ */
+void SessionReplay::Step()
+{
+  if (m_socket == NULL || m_timer.IsRunning())
+    return;
+
+  while (m_next < m_records.size())
+  {
+    SessionRecord &record = m_records[m_next];
+
+    if (record.direction != 'R')
+    {
+      m_expected += record.data.length();
+      m_next++;
+      m_waited = false;
+      continue;
+    }
+
+    if (m_received < m_expected)
+      return;
+
+    if (!m_fast && !m_waited)
+    {
+      m_waited = true;
+      long delay = record.time;
+      if (m_next > 0)
+        delay -= m_records[m_next - 1].time;
+      if (delay > 0) {
+        m_timer.Start(delay, true);
+        return;
+      }
+    }
+
+    m_socket->Write(record.data.data() + m_written, record.data.length() - m_written);
+    m_written += m_socket->LastCount();
+    if (m_written < record.data.length())
+      return; // the rest is written on wxSOCKET_OUTPUT
+
+    m_written = 0;
+    m_next++;
+    m_waited = false;
+  }
+}
+
+void SessionReplay::OnSocket(wxSocketEvent& event)
+{
+  switch (event.GetSocketEvent())
+  {
+  case wxSOCKET_INPUT:
+    {
+      // What wxMaxima sends is only counted
+      char buffer[4096];
+      do {
+        m_socket->Read(buffer, sizeof(buffer));
+        m_received += m_socket->LastCount();
+      } while (m_socket->LastCount() > 0);
+      Step();
+    }
+    break;
+  case wxSOCKET_OUTPUT:
+    Step();
+    break;
+  case wxSOCKET_LOST:
+    Stop();
+    break;
+  default:
+    break;
+  }
+}
+
+void SessionReplay::OnTimer(wxTimerEvent& event)
+{
+  Step();
+}
+
+BEGIN_EVENT_TABLE(SessionReplay, wxEvtHandler)
+  EVT_SOCKET(session_socket_id, SessionReplay::OnSocket)
+  EVT_TIMER(session_timer_id, SessionReplay::OnTimer)
+END_EVENT_TABLE()
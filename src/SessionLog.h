@@ -0,0 +1,97 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+
+#ifndef _SESSIONLOG_H_
+#define _SESSIONLOG_H_
+
+#include <wx/wx.h>
+#include <wx/ffile.h>
+#include <wx/socket.h>
+#include <wx/timer.h>
+
+#include <string>
+#include <vector>
+
+// A session file has the line "wxMaxima session 1" followed by one
+// record for each chunk of data written to or read from the socket of
+// maxima: a line with the direction (S for sent to maxima, R for
+// received from maxima), the time in milliseconds since the start of
+// the recording and the number of bytes, then the bytes and a newline.
+
+// Writes everything wxMaxima and maxima send to each other to a
+// session file.
+class SessionRecorder
+{
+public:
+  SessionRecorder() {};
+  ~SessionRecorder() { Close(); }
+  bool Open(wxString file);
+  void Close();
+  bool IsOpen() { return m_file.IsOpened(); }
+  void Sent(const char *data, size_t length) { Write('S', data, length); }
+  void Received(const char *data, size_t length) { Write('R', data, length); }
+private:
+  void Write(char direction, const char *data, size_t length);
+  wxFFile m_file;
+  wxStopWatch m_time;
+};
+
+struct SessionRecord
+{
+  char direction;
+  long time;
+  std::string data;
+};
+
+// Stands in for maxima: connects to the server of wxMaxima like maxima
+// does and sends what maxima sent in a recorded session. Before each
+// piece of output it waits until wxMaxima has sent as much as it had
+// sent at that point of the recording, and unless fast is set also
+// for the time that passed between the two in the recording.
+class SessionReplay : public wxEvtHandler
+{
+public:
+  SessionReplay(bool fast);
+  ~SessionReplay();
+  bool Load(wxString file);
+  bool Start(int port);
+  void Stop();
+  bool IsFinished() { return m_next >= m_records.size(); }
+private:
+  enum {
+    session_socket_id,
+    session_timer_id
+  };
+  void OnSocket(wxSocketEvent& event);
+  void OnTimer(wxTimerEvent& event);
+  void Step();
+  std::vector<SessionRecord> m_records;
+  size_t m_next;      // next record to replay
+  size_t m_written;   // bytes of it which were written
+  size_t m_expected;  // bytes wxMaxima sent in the recording so far
+  size_t m_received;  // bytes wxMaxima sent to us
+  bool m_waited;      // the delay before the next record is over
+  bool m_fast;
+  wxSocketClient *m_socket;
+  wxTimer m_timer;
+  DECLARE_EVENT_TABLE()
+};
+
+#endif // _SESSIONLOG_H_
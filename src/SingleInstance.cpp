@@ -0,0 +1,83 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+
+#include "SingleInstance.h"
+#include "wxMaxima.h"
+
+#include <wx/utils.h>
+#include <wx/filename.h>
+
+#define INSTANCE_TOPIC wxT("wxMaxima")
+
+#if wxCHECK_VERSION(2,9,0)
+bool InstanceConnection::OnExecute(const wxString& WXUNUSED(topic), const void *data,
+                                   size_t size, wxIPCFormat format)
+{
+  wxString file = GetTextFromData(data, size, format);
+#else
+bool InstanceConnection::OnExecute(const wxString& WXUNUSED(topic), wxChar *data,
+                                   int WXUNUSED(size), wxIPCFormat WXUNUSED(format))
+{
+  wxString file(data);
+#endif
+
+  wxGetApp().NewWindow(file);
+  return true;
+}
+
+wxConnectionBase *InstanceServer::OnAcceptConnection(const wxString& topic)
+{
+  if (topic != INSTANCE_TOPIC)
+    return NULL;
+  return new InstanceConnection;
+}
+
+wxString InstanceService()
+{
+#if defined __WXMSW__
+  return wxT("wxMaxima-") + wxGetUserId();
+#else
+  // A file name makes wxServer use a unix domain socket
+  return wxGetHomeDir() + wxT("/.wxmaxima-") + wxGetHostName();
+#endif
+}
+
+bool SendToRunningInstance(wxString file)
+{
+  // The running instance has a different working directory
+  if (file.Length() > 0)
+  {
+    wxFileName name(file);
+    name.MakeAbsolute();
+    file = name.GetFullPath();
+  }
+
+  wxLogNull disableErrors;
+  wxClient client;
+  wxConnectionBase *connection =
+    client.MakeConnection(wxT("localhost"), InstanceService(), INSTANCE_TOPIC);
+  if (connection == NULL)
+    return false;
+
+  bool sent = connection->Execute(file);
+  connection->Disconnect();
+  delete connection;
+  return sent;
+}
@@ -0,0 +1,53 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+
+#ifndef _SINGLEINSTANCE_H_
+#define _SINGLEINSTANCE_H_
+
+#include <wx/wx.h>
+#include <wx/ipc.h>
+
+// In single instance mode the first wxMaxima listens on a local socket
+// (a DDE server on Windows). Later invocations send the file they were
+// asked to open to it and exit; the running process opens a new window
+// for the file.
+class InstanceConnection : public wxConnection
+{
+public:
+#if wxCHECK_VERSION(2,9,0)
+  bool OnExecute(const wxString& topic, const void *data, size_t size, wxIPCFormat format);
+#else
+  bool OnExecute(const wxString& topic, wxChar *data, int size, wxIPCFormat format);
+#endif
+};
+
+class InstanceServer : public wxServer
+{
+public:
+  wxConnectionBase *OnAcceptConnection(const wxString& topic);
+};
+
+// Name of the socket (or the DDE service) of the running instance.
+wxString InstanceService();
+// Asks the running instance to open file. Returns false if there is no
+// instance which accepts it.
+bool SendToRunningInstance(wxString file);
+
+#endif // _SINGLEINSTANCE_H_
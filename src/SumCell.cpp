@@ -131,9 +131,9 @@ void SumCell::RecalculateWidths(CellParser& parser, int fontsize, bool all)
   {
     wxDC& dc = parser.GetDC();
     int fontsize1 = (int) ((fontsize * 1.5 * scale + 0.5));
-    dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                      false, false, false,
-                      parser.GetTeXCMEX()));
+    dc.SetFont(CellParser::GetFont(fontsize1,
+                                   false, false, false,
+                                   parser.GetTeXCMEX()));
     dc.GetTextExtent(m_sumStyle == SM_SUM ? wxT(SUM_SIGN) : wxT(PROD_SIGN), &m_signWidth, &m_signSize);
     m_signWCenter = m_signWidth / 2;
     m_signTop = (2* m_signSize) / 5;
@@ -184,9 +184,9 @@ void SumCell::Draw(CellParser& parser, wxPoint point, int fontsize, bool all)
     {
       SetForeground(parser);
       int fontsize1 = (int) ((fontsize * 1.5 * scale + 0.5));
-      dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                        false, false, false,
-                        parser.GetTeXCMEX()));
+      dc.SetFont(CellParser::GetFont(fontsize1,
+                                     false, false, false,
+                                     parser.GetTeXCMEX()));
       dc.DrawText(m_sumStyle == SM_SUM ? wxT(SUM_SIGN) : wxT(PROD_SIGN),
                   sign.x + m_signWCenter - m_signWidth / 2,
                   sign.y - m_signTop);
@@ -18,6 +18,7 @@
 ///
 
 #include "TextCell.h"
+#include "TextExtentCache.h"
 #include "Setup.h"
 
 TextCell::TextCell() : MathCell()
@@ -87,27 +88,33 @@ void TextCell::RecalculateWidths(CellParser& parser, int fontsize, bool all)
     if ((m_textStyle == TS_LABEL) || (m_textStyle == TS_MAIN_PROMPT)) {
 	  // Check for output annotations (/R/ for CRE and /T/ for Taylor expressions)
       if (m_text.Right(2) != wxT("/ "))
-        dc.GetTextExtent(wxT("(\%oXXX)"), &m_width, &m_height);
+        TextExtentCache::GetTextExtent(dc, wxT("(\%oXXX)"), &m_width, &m_height);
       else
-        dc.GetTextExtent(wxT("(\%oXXX)/R/"), &m_width, &m_height);
-      m_fontSizeLabel = m_fontSize;
-      dc.GetTextExtent(m_text, &m_labelWidth, &m_labelHeight);
-      while (m_labelWidth >= m_width) {
-        int fontsize1 = (int) (((double) --m_fontSizeLabel) * scale + 0.5);
-        dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-              parser.IsItalic(m_textStyle),
-              parser.IsBold(m_textStyle),
-              false, //parser.IsUnderlined(m_textStyle),
-              parser.GetFontName(m_textStyle),
-              parser.GetFontEncoding()));
-        dc.GetTextExtent(m_text, &m_labelWidth, &m_labelHeight);
+        TextExtentCache::GetTextExtent(dc, wxT("(\%oXXX)/R/"), &m_width, &m_height);
+      // The font size which fits is remembered for the font, size and text
+      wxString labelKey = TextExtentCache::GetFontKey(dc) +
+        wxString::Format(wxT(" %d %g %d "), m_fontSize, scale, m_width) + m_text;
+      if (!TextExtentCache::FindLabel(labelKey, &m_fontSizeLabel, &m_labelWidth, &m_labelHeight)) {
+        m_fontSizeLabel = m_fontSize;
+        TextExtentCache::GetTextExtent(dc, m_text, &m_labelWidth, &m_labelHeight);
+        while (m_labelWidth >= m_width) {
+          int fontsize1 = (int) (((double) --m_fontSizeLabel) * scale + 0.5);
+          dc.SetFont(CellParser::GetFont(fontsize1,
+                             parser.IsItalic(m_textStyle),
+                             parser.IsBold(m_textStyle),
+                             false, //parser.IsUnderlined(m_textStyle),
+                             parser.GetFontName(m_textStyle),
+                             parser.GetFontEncoding()));
+          dc.GetTextExtent(m_text, &m_labelWidth, &m_labelHeight);
+        }
+        TextExtentCache::AddLabel(labelKey, m_fontSizeLabel, m_labelWidth, m_labelHeight);
       }
     }
 
     /// Check if we are using jsMath and have jsMath character
     else if (m_altJs && parser.CheckTeXFonts())
     {
-      dc.GetTextExtent(m_altJsText, &m_width, &m_height);
+      TextExtentCache::GetTextExtent(dc, m_altJsText, &m_width, &m_height);
 
       if (m_texFontname == wxT("jsMath-cmsy10"))
         m_height = m_height / 2;
@@ -116,19 +123,19 @@ void TextCell::RecalculateWidths(CellParser& parser, int fontsize, bool all)
     /// We are using a special symbol
     else if (m_alt)
     {
-      dc.GetTextExtent(m_altText, &m_width, &m_height);
+      TextExtentCache::GetTextExtent(dc, m_altText, &m_width, &m_height);
     }
 
     /// Empty string has height of X
     else if (m_text == wxEmptyString)
     {
-      dc.GetTextExtent(wxT("X"), &m_width, &m_height);
+      TextExtentCache::GetTextExtent(dc, wxT("X"), &m_width, &m_height);
       m_width = 0;
     }
 
     /// This is the default.
     else
-      dc.GetTextExtent(m_text, &m_width, &m_height);
+      TextExtentCache::GetTextExtent(dc, m_text, &m_width, &m_height);
 
     m_width = m_width + 2 * SCALE_PX(MC_TEXT_PADDING, scale);
     m_height = m_height + 2 * SCALE_PX(MC_TEXT_PADDING, scale);
@@ -218,42 +225,42 @@ void TextCell::SetFont(CellParser& parser, int fontsize)
   // Use jsMath
   if (m_altJs && parser.CheckTeXFonts())
   {
-    dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                      wxFONTSTYLE_NORMAL,
-                      parser.IsBold(m_textStyle),
-                      parser.IsUnderlined(m_textStyle),
-                      m_texFontname));
+    dc.SetFont(CellParser::GetFont(fontsize1,
+                                   wxFONTSTYLE_NORMAL,
+                                   parser.IsBold(m_textStyle),
+                                   parser.IsUnderlined(m_textStyle),
+                                   m_texFontname));
   }
 
   // We have an alternative symbol
   else if (m_alt)
-    dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                      wxFONTSTYLE_NORMAL,
-                      parser.IsBold(m_textStyle),
-                      false,
-                      m_fontname != wxEmptyString ?
-                          m_fontname : parser.GetFontName(m_textStyle),
-                      parser.GetFontEncoding()));
+    dc.SetFont(CellParser::GetFont(fontsize1,
+                                   wxFONTSTYLE_NORMAL,
+                                   parser.IsBold(m_textStyle),
+                                   false,
+                                   m_fontname != wxEmptyString ?
+                                       m_fontname : parser.GetFontName(m_textStyle),
+                                   parser.GetFontEncoding()));
 
   // Titles, sections, subsections - don't underline
   else if ((m_textStyle == TS_TITLE) ||
            (m_textStyle == TS_SECTION) ||
            (m_textStyle == TS_SUBSECTION))
-    dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                      parser.IsItalic(m_textStyle),
-                      parser.IsBold(m_textStyle),
-                      false,
-                      parser.GetFontName(m_textStyle),
-                      parser.GetFontEncoding()));
+    dc.SetFont(CellParser::GetFont(fontsize1,
+                                   parser.IsItalic(m_textStyle),
+                                   parser.IsBold(m_textStyle),
+                                   false,
+                                   parser.GetFontName(m_textStyle),
+                                   parser.GetFontEncoding()));
 
   // Default
   else
-    dc.SetFont(wxFont(fontsize1, wxFONTFAMILY_MODERN,
-                      parser.IsItalic(m_textStyle),
-                      parser.IsBold(m_textStyle),
-                      parser.IsUnderlined(m_textStyle),
-                      parser.GetFontName(m_textStyle),
-                      parser.GetFontEncoding()));
+    dc.SetFont(CellParser::GetFont(fontsize1,
+                                   parser.IsItalic(m_textStyle),
+                                   parser.IsBold(m_textStyle),
+                                   parser.IsUnderlined(m_textStyle),
+                                   parser.GetFontName(m_textStyle),
+                                   parser.GetFontEncoding()));
 }
 
 bool TextCell::IsOperator()
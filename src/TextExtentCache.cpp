@@ -0,0 +1,121 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#include "TextExtentCache.h"
+
+TextExtentMap TextExtentCache::s_current;
+TextExtentMap TextExtentCache::s_old;
+long TextExtentCache::s_hits = 0;
+long TextExtentCache::s_misses = 0;
+
+void TextExtentCache::GetTextExtent(wxDC &dc, const wxString &text,
+                                    wxCoord *width, wxCoord *height)
+{
+  if (text.Length() > MAX_TEXT_LENGTH) {
+    dc.GetTextExtent(text, width, height);
+    return;
+  }
+
+  wxString key = GetFontKey(dc) + wxT("\t") + text;
+  TextExtent extent;
+
+  if (!Find(key, &extent)) {
+    dc.GetTextExtent(text, &extent.width, &extent.height);
+    extent.fontSize = 0;
+    Add(key, extent);
+  }
+
+  *width = extent.width;
+  *height = extent.height;
+}
+
+bool TextExtentCache::FindLabel(const wxString &key, int *fontSize,
+                                wxCoord *width, wxCoord *height)
+{
+  TextExtent extent;
+  if (!Find(wxT("\v") + key, &extent))
+    return false;
+
+  *fontSize = extent.fontSize;
+  *width = extent.width;
+  *height = extent.height;
+  return true;
+}
+
+void TextExtentCache::AddLabel(const wxString &key, int fontSize,
+                               wxCoord width, wxCoord height)
+{
+  TextExtent extent;
+  extent.fontSize = fontSize;
+  extent.width = width;
+  extent.height = height;
+  Add(wxT("\v") + key, extent);
+}
+
+void TextExtentCache::Clear()
+{
+  s_current.clear();
+  s_old.clear();
+}
+
+wxString TextExtentCache::GetFontKey(wxDC &dc)
+{
+  wxFont font = dc.GetFont();
+  double scaleX, scaleY;
+  dc.GetUserScale(&scaleX, &scaleY);
+  wxSize ppi = dc.GetPPI();
+
+  return wxString::Format(wxT("%d %d %d %d %d %d %g %g %d %d "),
+                          font.GetPointSize(), font.GetFamily(),
+                          font.GetStyle(), font.GetWeight(),
+                          font.GetUnderlined(), font.GetEncoding(),
+                          scaleX, scaleY, ppi.x, ppi.y) +
+         font.GetFaceName();
+}
+
+bool TextExtentCache::Find(const wxString &key, TextExtent *extent)
+{
+  TextExtentMap::iterator it = s_current.find(key);
+  if (it != s_current.end()) {
+    *extent = it->second;
+    s_hits++;
+    return true;
+  }
+
+  it = s_old.find(key);
+  if (it != s_old.end()) {
+    *extent = it->second;
+    s_old.erase(it);
+    Add(key, *extent);
+    s_hits++;
+    return true;
+  }
+
+  s_misses++;
+  return false;
+}
+
+void TextExtentCache::Add(const wxString &key, const TextExtent &extent)
+{
+  if (s_current.size() >= MAX_ENTRIES) {
+    s_old = s_current;
+    s_current.clear();
+  }
+  s_current[key] = extent;
+}
@@ -0,0 +1,70 @@
+///
+///  Copyright (C) 2004-2011 Andrej Vodopivec <andrej.vodopivec@gmail.com>
+///
+///  This program is free software; you can redistribute it and/or modify
+///  it under the terms of the GNU General Public License as published by
+///  the Free Software Foundation; either version 2 of the License, or
+///  (at your option) any later version.
+///
+///  This program is distributed in the hope that it will be useful,
+///  but WITHOUT ANY WARRANTY; without even the implied warranty of
+///  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///  GNU General Public License for more details.
+///
+///
+///  You should have received a copy of the GNU General Public License
+///  along with this program; if not, write to the Free Software
+///  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+///
+
+#ifndef _TEXTEXTENTCACHE_H_
+#define _TEXTEXTENTCACHE_H_
+
+#include <wx/wx.h>
+#include <wx/hashmap.h>
+
+struct TextExtent
+{
+  wxCoord width;
+  wxCoord height;
+  int fontSize; // only for labels
+};
+
+WX_DECLARE_STRING_HASH_MAP(TextExtent, TextExtentMap);
+
+// Sizes of text measured with wxDC::GetTextExtent, shared by the cells
+// of all documents. An entry is found by the font, the scale and the
+// resolution of the DC and the text, so a document which is laid out
+// again after a resize or a zoom mostly measures text it has measured
+// before.
+//
+// The cache keeps two generations of at most MAX_ENTRIES entries. When
+// the current one is full it replaces the old one; entries which are
+// found in the old one are moved to the current one. Long texts, which
+// are rarely measured twice, are not cached.
+class TextExtentCache
+{
+public:
+  static void GetTextExtent(wxDC &dc, const wxString &text, wxCoord *width, wxCoord *height);
+  // The font size and the size of a label which was made to fit, see
+  // TextCell::RecalculateWidths. key describes the label, its width and
+  // the font it starts with.
+  static bool FindLabel(const wxString &key, int *fontSize, wxCoord *width, wxCoord *height);
+  static void AddLabel(const wxString &key, int fontSize, wxCoord width, wxCoord height);
+  // Describes everything which changes the size of text on dc.
+  static wxString GetFontKey(wxDC &dc);
+  static long GetHits() { return s_hits; }
+  static long GetMisses() { return s_misses; }
+  static void Clear();
+private:
+  enum {
+    MAX_ENTRIES = 8192,
+    MAX_TEXT_LENGTH = 256
+  };
+  static bool Find(const wxString &key, TextExtent *extent);
+  static void Add(const wxString &key, const TextExtent &extent);
+  static TextExtentMap s_current, s_old;
+  static long s_hits, s_misses;
+};
+
+#endif // _TEXTEXTENTCACHE_H_
@@ -47,19 +47,60 @@ IMPLEMENT_APP(MyApp)
 bool MyApp::OnInit()
 {
   int lang = wxLANGUAGE_UNKNOWN;
+  bool batch = false;
+  wxString batchInput, batchOutput;
+  m_exitCode = 0;
+  m_replayFast = false;
+  m_checker = NULL;
+  m_instanceServer = NULL;
+  m_passedOn = false;
 
 #if defined __WXMSW__
   wxCmdLineParser cmdLineParser(argc, argv);
   cmdLineParser.AddOption(wxT("f"), wxT("ini"), wxT("use ini file"),wxCMD_LINE_VAL_STRING);
-  cmdLineParser.AddOption(wxT("o"), wxT("open"), wxT("open file"), wxCMD_LINE_VAL_STRING);
+  cmdLineParser.AddOption(wxT("o"), wxT("open"), wxT("open file (output file with --batch)"), wxCMD_LINE_VAL_STRING);
+  cmdLineParser.AddSwitch(wxEmptyString, wxT("batch"), wxT("evaluate the input file, save it and exit"));
+  cmdLineParser.AddParam(wxT("input file"), wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL);
+  cmdLineParser.AddOption(wxEmptyString, wxT("record"), wxT("record the session with maxima to a file"), wxCMD_LINE_VAL_STRING);
+  cmdLineParser.AddOption(wxEmptyString, wxT("replay"), wxT("replay a recorded session instead of starting maxima"), wxCMD_LINE_VAL_STRING);
+  cmdLineParser.AddSwitch(wxEmptyString, wxT("replay-fast"), wxT("replay without the recorded delays"));
   cmdLineParser.Parse();
+  cmdLineParser.Found(wxT("record"), &m_recordFile);
+  cmdLineParser.Found(wxT("replay"), &m_replayFile);
+  m_replayFast = cmdLineParser.Found(wxT("replay-fast"));
+  if (cmdLineParser.Found(wxT("batch"))) {
+    batch = true;
+    cmdLineParser.Found(wxT("o"), &batchOutput);
+    if (cmdLineParser.GetParamCount() > 0)
+      batchInput = cmdLineParser.GetParam(0);
+  }
   wxString ini, file;
+  cmdLineParser.Found(wxT("o"), &file);
   if (cmdLineParser.Found(wxT("f"),&ini))
     wxConfig::Set(new wxFileConfig(ini));
   else
     wxConfig::Set(new wxConfig(wxT("wxMaxima")));
 #else
   wxConfig::Set(new wxConfig(wxT("wxMaxima")));
+
+  // wxmaxima [--record session] [--replay session [--replay-fast]]
+  //          [--batch input -o output | file]
+  for (int i = 1; i < argc; i++)
+  {
+    wxString arg(argv[i]);
+    if (arg == wxT("--batch"))
+      batch = true;
+    else if (arg == wxT("-o") && i + 1 < argc)
+      batchOutput = wxString(argv[++i]);
+    else if (arg == wxT("--record") && i + 1 < argc)
+      m_recordFile = wxString(argv[++i]);
+    else if (arg == wxT("--replay") && i + 1 < argc)
+      m_replayFile = wxString(argv[++i]);
+    else if (arg == wxT("--replay-fast"))
+      m_replayFast = true;
+    else
+      batchInput = arg;
+  }
 #endif
 
   wxConfigBase *config = wxConfig::Get();
@@ -98,6 +139,43 @@ bool MyApp::OnInit()
 #endif
 
 
+  if (batch)
+  {
+    if (batchInput.Length() == 0 || batchOutput.Length() == 0 || !wxFileExists(batchInput))
+    {
+      wxFprintf(stderr, wxT("usage: wxmaxima --batch input.wxm(x) -o output.wxmx|.wxm|.html|.tex\n"));
+      return false;
+    }
+    BatchWindow(batchInput, batchOutput);
+    return true;
+  }
+
+#if !defined __WXMSW__
+  wxString file = batchInput;
+#endif
+
+  // In single instance mode the file is opened by the running wxMaxima
+  bool singleInstance = false;
+  config->Read(wxT("singleInstance"), &singleInstance);
+  if (singleInstance && m_recordFile.Length() == 0 && m_replayFile.Length() == 0)
+  {
+    m_checker = new wxSingleInstanceChecker(wxT("wxMaxima-") + wxGetUserId());
+    if (!m_checker->IsAnotherRunning())
+    {
+      m_instanceServer = new InstanceServer;
+      if (!m_instanceServer->Create(InstanceService()))
+      {
+        delete m_instanceServer;
+        m_instanceServer = NULL;
+      }
+    }
+    else if (SendToRunningInstance(file))
+    {
+      m_passedOn = true;
+      return true;
+    }
+  }
+
 #if defined (__WXMAC__)
   wxApp::SetExitOnFrameDelete(false);
   wxMenuBar *menuBar = new wxMenuBar;
@@ -112,21 +190,50 @@ bool MyApp::OnInit()
   Connect(wxID_EXIT, wxEVT_COMMAND_MENU_SELECTED, wxCommandEventHandler(MyApp::OnFileMenu));
 #endif
 
-#if defined __WXMSW__
-  if (cmdLineParser.Found(wxT("o"), &file))
-    NewWindow(wxString(file));
-  else
-    NewWindow();
-#else
-  if (argc==2)
-    NewWindow(wxString(argv[1]));
-  else
-    NewWindow();
-#endif
+  NewWindow(file);
 
   return true;
 }
 
+int MyApp::OnRun()
+{
+  // There is no window to run the main loop for
+  if (m_passedOn)
+    return 0;
+
+  int code = wxApp::OnRun();
+  return m_exitCode != 0 ? m_exitCode : code;
+}
+
+int MyApp::OnExit()
+{
+  if (m_instanceServer != NULL)
+    delete m_instanceServer;
+  if (m_checker != NULL)
+    delete m_checker;
+  CellParser::ClearFonts();
+  return wxApp::OnExit();
+}
+
+/***
+ * Evaluates input and writes the result to output without showing the
+ * window. The window still exists because the document needs it for
+ * the layout of the output, so wxGTK needs an X display even in batch
+ * mode.
+ */
+void MyApp::BatchWindow(wxString input, wxString output)
+{
+  wxMaxima *frame = new wxMaxima((wxFrame *)NULL, -1, _("wxMaxima"),
+                                 wxDefaultPosition, wxSize(950, 650));
+
+  frame->SetBatchMode(output);
+  frame->SetOpenFile(input);
+  frame->SetSession(m_recordFile, m_replayFile, m_replayFast);
+
+  SetTopWindow(frame);
+  frame->InitSession();
+}
+
 #if defined __WXMAC__
 int window_counter = 0;
 #endif
@@ -182,9 +289,23 @@ void MyApp::NewWindow(wxString file)
     frame->SetTitle(wxString::Format(_("untitled %d"), ++window_counter));
 #endif
 
+  // Only the first window records or replays a session
+  frame->SetSession(m_recordFile, m_replayFile, m_replayFast);
+  m_recordFile = m_replayFile = wxEmptyString;
+
+  // Another window may have a spare maxima ready to be used
+  wxMaxima *donor = NULL;
+  wxWindowList::compatibility_iterator node = wxTopLevelWindows.GetFirst();
+  while (node != NULL && donor == NULL) {
+    wxMaxima *other = dynamic_cast<wxMaxima *>(node->GetData());
+    if (other != NULL && other != frame && other->HasSpare())
+      donor = other;
+    node = node->GetNext();
+  }
+
   SetTopWindow(frame);
   frame->Show(true);
-  frame->InitSession();
+  frame->InitSession(donor);
   frame->ShowTip(false);
 }
 
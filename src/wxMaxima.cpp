@@ -40,12 +40,14 @@
 #include "EditorCell.h"
 #include "SlideShowCell.h"
 #include "PlotFormatWiz.h"
+#include "EvaluationTimes.h"
 
 #include <wx/clipbrd.h>
 #include <wx/filedlg.h>
 #include <wx/utils.h>
 #include <wx/msgdlg.h>
 #include <wx/textfile.h>
+#include <wx/ffile.h>
 #include <wx/tokenzr.h>
 #include <wx/mimetype.h>
 #include <wx/dynlib.h>
@@ -63,6 +65,10 @@
 #include <wx/url.h>
 #include <wx/sstream.h>
 
+#if !defined __WXMSW__
+ #include <signal.h>
+#endif
+
 #if defined __WXMAC__
  #if !wxCHECK_VERSION(2,9,0)
   #include <wx/mac/private.h>
@@ -75,7 +81,9 @@
 #endif
 
 enum {
-  maxima_process_id
+  maxima_process_id,
+  maxima_stdio_timer_id,
+  kernel_timer_id
 };
 
 wxMaxima::wxMaxima(wxWindow *parent, int id, const wxString title,
@@ -86,6 +94,25 @@ wxMaxima::wxMaxima(wxWindow *parent, int id, const wxString title,
   m_pid = -1;
   m_inLispMode = false;
   m_first = true;
+  m_framed = false;
+  m_inFlight = 0;
+  m_atPrompt = true;
+  m_cancelled = false;
+  m_discarded = 0;
+  m_pipelineDepth = 1;
+  wxConfig::Get()->Read(wxT("pipelineDepth"), &m_pipelineDepth);
+  m_questionPending = false;
+  m_saveSessionPending = false;
+  m_runCells = 0;
+  m_runTime = -1;
+  m_kernels = NULL;
+  m_spare = NULL;
+  m_process = NULL;
+  m_replaying = 0;
+  m_replay = NULL;
+  m_batchMode = false;
+  m_batchCell = 0;
+  m_batchErrors = 0;
   m_isRunning = false;
   m_promptSuffix = wxT("<PROMPT-S/>");
   m_promptPrefix = wxT("<PROMPT-P/>");
@@ -95,6 +122,15 @@ wxMaxima::wxMaxima(wxWindow *parent, int id, const wxString title,
 
   m_client = NULL;
   m_server = NULL;
+  m_stdio = false;
+  m_stdioTimer.SetOwner(this, maxima_stdio_timer_id);
+  m_kernelTimer.SetOwner(this, kernel_timer_id);
+
+  m_parserThread = NULL;
+  bool parseInThread = false;
+  wxConfig::Get()->Read(wxT("parseInThread"), &parseInThread);
+  if (parseInThread)
+    StartParserThread();
 
   wxConfig::Get()->Read(wxT("lastPath"), &m_lastPath);
   m_lastPrompt = wxEmptyString;
@@ -142,6 +178,9 @@ wxMaxima::~wxMaxima()
   if (m_client != NULL)
     m_client->Destroy();
 
+  if (m_replay != NULL)
+    delete m_replay;
+
 #if WXM_PRINT
   delete m_printData;
 #endif
@@ -236,32 +275,46 @@ void wxMaxima::CheckForPrintingSupport()
 
 #endif
 
-void wxMaxima::InitSession()
+void wxMaxima::InitSession(wxMaxima *donor)
 {
   bool server = false;
   int defaultPort = 4010;
 
+  bool anyPort = false;
+
   wxConfig::Get()->Read(wxT("defaultPort"), &defaultPort);
-  m_port = defaultPort;
+  wxConfig::Get()->Read(wxT("anyPort"), &anyPort);
+  // With port 0 the system chooses a free port, see StartServer
+  m_port = anyPort ? 0 : defaultPort;
 
   while (!(server = StartServer()))
   {
-    m_port++;
+    if (m_port == 0)
+      m_port = defaultPort;
+    else
+      m_port++;
     if (m_port > defaultPort + 50)
     {
-      wxMessageBox(_("wxMaxima could not start the server.\n\n"
-                     "Please check you have network support\n"
-                     "enabled and try again!"),
-                   _("Fatal error"),
-                   wxOK | wxICON_ERROR);
+      ReportError(_("wxMaxima could not start the server.\n\n"
+                    "Please check you have network support\n"
+                    "enabled and try again!"),
+                  _("Fatal error"),
+                  wxOK | wxICON_ERROR);
       break;
     }
   }
 
   if (!server)
     SetStatusText(_("Starting server failed"));
+  else if (donor != NULL && TakeSpareFrom(donor))
+    return;
   else if (!StartMaxima())
     SetStatusText(_("Starting Maxima process failed"), 1);
+  else
+    return;
+
+  if (m_batchMode)
+    FinishBatch(2);
 }
 
 void wxMaxima::FirstOutput(wxString s)
@@ -275,7 +328,13 @@ void wxMaxima::FirstOutput(wxString s)
     m_lispVersion = lisp.GetMatch(s, 1);
 
   m_lastPrompt = wxT("(%i1) ");
+  m_resultCache.SetVersion(m_maximaVersion + m_lispVersion);
+
+  LoadSymbols();
+}
 
+void wxMaxima::LoadSymbols()
+{
   /// READ FUNCTIONS FOR AUTOCOMPLETION
 #if defined __WXMSW__
   wxString index = wxGetCwd();
@@ -314,135 +373,165 @@ void wxMaxima::ConsoleAppend(wxString s, int type)
   if (!t.Length())
     return ;
 
-  if (type != MC_TYPE_ERROR)
-    SetStatusText(_("Parsing output"), 1);
+  // With framed output errors are counted when their record arrives
+  if (m_batchMode && !m_framed && type == MC_TYPE_DEFAULT &&
+      s.Find(wxT("-- an error.")) > -1)
+    m_batchErrors++;
+
+  // Output of the cells which are evaluated again after they were
+  // taken from the cache is already in the document
+  if (type == MC_TYPE_DEFAULT && m_replaying > 0)
+    return ;
 
-  if (type == MC_TYPE_DEFAULT)
+  // Output over the limit is kept only if it is at the end
+  if (type == MC_TYPE_DEFAULT && m_console->GetWorkingGroup() != NULL)
   {
-    while (s.Length() > 0)
+    bool overflowing = m_outputBudget.IsOverflowing();
+    if (!m_outputBudget.Add(s))
     {
-      int start = s.Find(wxT("<mth"));
-
-      if (start == -1) {
-        t = s;
-        t.Trim();
-        t.Trim(false);
-        if (t.Length())
-          DoRawConsoleAppend(s, MC_TYPE_DEFAULT);
-        s = wxEmptyString;
-      }
-
-      else {
-        wxString pre = s.SubString(0, start - 1);
-        wxString pre1(pre);
-        pre1.Trim();
-        pre1.Trim(false);
-        int end = s.Find(wxT("</mth>"));
-        if (end == -1)
-          end = s.Length();
-        else
-          end += 5;
-        wxString rest = s.SubString(start, end);
-
-        if (pre1.Length()) {
-          DoRawConsoleAppend(pre, MC_TYPE_DEFAULT);
-          DoConsoleAppend(wxT("<span>") + rest +
-                          wxT("</span>"), type, false);
-        }
-        else {
-          DoConsoleAppend(wxT("<span>") + rest +
-                          wxT("</span>"), type, false);
-        }
-        s = s.SubString(end + 1, s.Length());
-      }
+      if (!overflowing)
+        SetStatusText(_("Output limit reached, only the end of the output will be displayed"), 1);
+      return ;
     }
   }
 
-  else if (type == MC_TYPE_PROMPT) {
+  if (type != MC_TYPE_ERROR)
+    SetStatusText(_("Parsing output"), 1);
+
+  if (type == MC_TYPE_PROMPT) {
     SetStatusText(_("Ready for user input"), 1);
     m_lastPrompt = s;
+  }
 
-    if (s.StartsWith(wxT("MAXIMA> "))) {
-      s = s.Right(8);
-    }
-    else
-      s = s + wxT(" ");
+  QueueJob(new ParserJob(ParserJob::JOB_OUTPUT, s, type));
+}
 
-    DoConsoleAppend(wxT("<span>") + s + wxT("</span>"), type, true);
-  }
+/***
+ * Parses the job in the parser thread if it is running. Otherwise the
+ * job is parsed and added to the document immediately.
+ */
+void wxMaxima::QueueJob(ParserJob *job)
+{
+  if (job->GetKind() == ParserJob::JOB_PROMPT &&
+      job->GetText().StartsWith(wxT("(%i")) &&
+      m_console->GetWorkingGroup() != NULL)
+    m_console->GetWorkingGroup()->SetTime(GC_TIME_PROMPT);
 
-  else if (type == MC_TYPE_ERROR)
-    DoRawConsoleAppend(s, MC_TYPE_ERROR);
+  if (job->GetKind() == ParserJob::JOB_PROMPT)
+    m_atPrompt = true;
 
-  else
-    DoConsoleAppend(wxT("<span>") + s + wxT("</span>"), type, false);
+  if (m_parserThread != NULL)
+    m_parserThread->AddJob(job);
+  else {
+    job->Parse(m_MParser);
+    HandleJob(job);
+  }
 }
 
-void wxMaxima::DoConsoleAppend(wxString s, int type, bool newLine,
-                               bool bigSkip)
+/***
+ * Adds the cells of a parsed job to the document and deletes the job.
+ */
+void wxMaxima::HandleJob(ParserJob *job, GroupCell *group)
 {
-  MathCell* cell;
-
-  s.Replace(wxT("\n"), wxT(""), true);
+  // Output of an interrupted command
+  if (job->IsCancelled()) {
+    delete job;
+    return;
+  }
 
-  cell = m_MParser.ParseLine(s, type);
+  // The parser thread leaves images to the GUI thread
+  if (!job->IsParsed())
+    job->Parse(m_MParser);
 
-  if (cell == NULL)
+  for (int i = 0; i < job->GetLineCount(); i++)
   {
-    wxMessageBox(_("There was an error in generated XML!\n\n"
-                   "Please report this as a bug."), _("Error"),
-                 wxOK | wxICON_EXCLAMATION);
-    return ;
+    bool newLine;
+    MathCell *cell = job->TakeLine(i, &newLine);
+
+    if (cell == NULL)
+      ReportError(_("There was an error in generated XML!\n\n"
+                    "Please report this as a bug."), _("Error"),
+                  wxOK | wxICON_EXCLAMATION);
+    else
+      m_console->InsertLine(cell, newLine, group);
   }
 
-  cell->SetSkip(bigSkip);
-  m_console->InsertLine(cell, newLine || cell->BreakLineHere());
+  if (job->GetKind() == ParserJob::JOB_PROMPT)
+    HandlePrompt(job->GetText());
+
+  delete job;
 }
 
-void wxMaxima::DoRawConsoleAppend(wxString s, int type)
+void wxMaxima::OnParserThread(wxCommandEvent& event)
+{
+  if (m_parserThread == NULL)
+    return;
+
+  ParserJob *job;
+  while ((job = m_parserThread->GetFinishedJob()) != NULL)
+    HandleJob(job);
+}
+
+void wxMaxima::StartParserThread()
 {
-  if (type == MC_TYPE_MAIN_PROMPT)
+  m_parserThread = new ParserThread(this, parser_thread_id);
+  if (m_parserThread->Create() != wxTHREAD_NO_ERROR ||
+      m_parserThread->Run() != wxTHREAD_NO_ERROR)
   {
-    TextCell* cell = new TextCell(s);
-    cell->SetType(type);
-    m_console->InsertLine(cell, true);
+    delete m_parserThread;
+    m_parserThread = NULL;
   }
+}
 
-  else
-  {
-    wxStringTokenizer tokens(s, wxT("\n"));
-    int count = 0;
-    MathCell *tmp = NULL, *lst = NULL;
-    while (tokens.HasMoreTokens())
-    {
-      TextCell* cell = new TextCell(tokens.GetNextToken());
+/***
+ * Stops the parser thread. If handleJobs is true the output which
+ * was still being parsed is added to the document.
+ */
+void wxMaxima::StopParserThread(bool handleJobs)
+{
+  ParserThread *thread = m_parserThread;
+  m_parserThread = NULL;
 
-      cell->SetType(type);
+  thread->Stop();
 
-      if (tokens.HasMoreTokens())
-        cell->SetSkip(false);
+  ParserJob *job;
+  while ((job = thread->GetFinishedJob()) != NULL)
+  {
+    if (handleJobs)
+      HandleJob(job);
+    else
+      delete job;
+  }
 
-      if (lst == NULL)
-        tmp = lst = cell;
-      else {
-        lst->AppendCell(cell);
-        cell->ForceBreakLine(true);
-        lst = cell;
-      }
+  delete thread;
+}
 
-      count++;
-    }
-    m_console->InsertLine(tmp, true);
+void wxMaxima::DoConsoleAppend(wxString s, int type, bool newLine,
+                               bool bigSkip)
+{
+  MathCell* cell = ParserJob::ParseXml(m_MParser, s, type, bigSkip);
+
+  if (cell == NULL)
+  {
+    ReportError(_("There was an error in generated XML!\n\n"
+                  "Please report this as a bug."), _("Error"),
+                wxOK | wxICON_EXCLAMATION);
+    return ;
   }
+
+  m_console->InsertLine(cell, newLine || cell->BreakLineHere());
 }
 
-void wxMaxima::SendMaxima(wxString s, bool history)
+void wxMaxima::DoRawConsoleAppend(wxString s, int type)
 {
-  if (!m_variablesOK) {
-    m_variablesOK = true;
-    SetupVariables();
-  }
+  MathCell* cell = ParserJob::RawCells(s, type);
+
+  if (cell != NULL)
+    m_console->InsertLine(cell, true);
+}
 
+void wxMaxima::ConvertSpecialChars(wxString& s)
+{
 #if wxUSE_UNICODE
   s.Replace(wxT("\x00B2"), wxT("^2"));
   s.Replace(wxT("\x00B3"), wxT("^3"));
@@ -461,9 +550,20 @@ void wxMaxima::SendMaxima(wxString s, bool history)
   s.Replace(wxT("\x21D4"), wxT(" equiv "));
   s.Replace(wxT("\x00AC"), wxT(" not "));
 #endif
+}
+
+void wxMaxima::SendMaxima(wxString s, bool history, bool ahead)
+{
+  if (!m_variablesOK) {
+    m_variablesOK = true;
+    SetupVariables();
+  }
+
+  ConvertSpecialChars(s);
 
   SetStatusText(_("Maxima is calculating"), 1);
   m_dispReadOut = false;
+  m_atPrompt = false;
 
   /// Add this command to history
   if (history)
@@ -510,10 +610,20 @@ void wxMaxima::SendMaxima(wxString s, bool history)
 
   m_console->EnableEdit(false);
 
+  // Maxima answers soon, see StdioEvent
+  if (m_stdio && m_isConnected && m_stdioTimer.GetInterval() != 1)
+    m_stdioTimer.Start(1);
+
+  // Not read as the answer to a question, see SendAnswerMark
+  if (ahead)
+    s.Prepend(wxT("/*wx-ahead*/"));
+
 #if wxUSE_UNICODE
-  m_client->Write(s.utf8_str(), strlen(s.utf8_str()));
+  m_sendQueue.Write(s.utf8_str(), strlen(s.utf8_str()));
+  m_recorder.Sent(s.utf8_str(), strlen(s.utf8_str()));
 #else
-  m_client->Write(s.c_str(), s.Length());
+  m_sendQueue.Write(s.c_str(), s.Length());
+  m_recorder.Sent(s.c_str(), s.Length());
 #endif
 }
 
@@ -538,31 +648,14 @@ void wxMaxima::ClientEvent(wxSocketEvent& event)
     {
       read = m_client->LastCount();
       buffer[read] = 0;
-
-#if wxUSE_UNICODE
-      m_currentOutput += wxString(buffer, wxConvUTF8);
-#else
-      m_currentOutput += wxString(buffer, *wxConvCurrent);
-#endif
-
-      if (!m_dispReadOut && m_currentOutput != wxT("\n")) {
-        SetStatusText(_("Reading Maxima output"), 1);
-        m_dispReadOut = true;
-      }
-
-      if (m_first && m_currentOutput.Find(m_firstPrompt) > -1)
-        ReadFirstPrompt();
-
-      ReadLoadSymbols();
-
-      ReadMath();
-
-      ReadPrompt();
-
-      ReadLispError();
+      ReceiveOutput(buffer, read);
     }
     break;
 
+  case wxSOCKET_OUTPUT:
+    m_sendQueue.Flush();
+    break;
+
   case wxSOCKET_LOST:
     if (!m_closing)
       ConsoleAppend(wxT("\nCLIENT: Lost socket connection ...\n"
@@ -575,6 +668,9 @@ void wxMaxima::ClientEvent(wxSocketEvent& event)
     GetMenuBar()->Enable(menu_interrupt_id, false);
     m_client->Destroy();
     m_client = NULL;
+    m_sendQueue.SetSocket(NULL);
+    if (m_batchMode && !m_closing)
+      FinishBatch(2);
     m_isConnected = false;
     break;
 
@@ -583,6 +679,179 @@ void wxMaxima::ClientEvent(wxSocketEvent& event)
   }
 }
 
+/***
+ * Handles output read from maxima, through the socket or from the
+ * standard output of maxima.
+ */
+void wxMaxima::ReceiveOutput(const char *buffer, int read)
+{
+  m_currentOutput.Append(buffer, read);
+  m_recorder.Received(buffer, read);
+
+  if (m_console->GetWorkingGroup() != NULL)
+    m_console->GetWorkingGroup()->SetTime(GC_TIME_OUTPUT);
+
+  if (!m_dispReadOut &&
+      (m_currentOutput.Length() != 1 || m_currentOutput.Left(1) != wxT("\n"))) {
+    SetStatusText(_("Reading Maxima output"), 1);
+    m_dispReadOut = true;
+  }
+
+  if (m_first && m_currentOutput.Find(m_firstPrompt) > -1)
+    ReadFirstPrompt();
+
+  ReadOutput();
+}
+
+/***
+ * With m_stdio the standard output of maxima is read when the timer
+ * fires, since a pipe sends no events. The timer runs while maxima
+ * does. It fires every millisecond while an answer from maxima is
+ * expected and less often while maxima waits for the user.
+ */
+void wxMaxima::StdioEvent(wxTimerEvent& event)
+{
+  ReadStdio();
+
+  int interval = (m_atPrompt || m_questionPending) ? 50 : 1;
+  if (m_stdio && m_isConnected && m_stdioTimer.GetInterval() != interval)
+    m_stdioTimer.Start(interval);
+}
+
+void wxMaxima::ReadStdio()
+{
+  char buffer[SOCKET_SIZE + 1];
+
+  // Read returns what the pipe has once it has read something, so it
+  // only waits when nothing is available
+  while (m_process != NULL && m_process->IsInputAvailable())
+  {
+    m_input->Read(buffer, SOCKET_SIZE);
+    int read = m_input->LastRead();
+    if (read == 0)
+      break;
+    buffer[read] = 0;
+    ReceiveOutput(buffer, read);
+  }
+}
+
+/***
+ * Socket events of the additional maxima processes.
+ */
+void wxMaxima::KernelEvent(wxSocketEvent& event)
+{
+  MaximaKernel *kernel = m_kernels;
+  while (kernel != NULL && kernel->GetClient() != event.GetSocket())
+    kernel = kernel->next;
+  if (kernel == NULL && m_spare != NULL && m_spare->GetClient() == event.GetSocket())
+    kernel = m_spare;
+  if (kernel == NULL)
+    return;
+
+  char buffer[SOCKET_SIZE + 1];
+  wxSocketBase *client = kernel->GetClient();
+  switch (event.GetSocketEvent())
+  {
+
+  case wxSOCKET_INPUT:
+    client->Read(buffer, SOCKET_SIZE);
+    if (!client->Error())
+    {
+      kernel->m_output.Append(buffer, client->LastCount());
+      ReadKernel(kernel);
+    }
+    break;
+
+  case wxSOCKET_OUTPUT:
+    kernel->m_input.Flush();
+    break;
+
+  case wxSOCKET_LOST:
+    if (kernel->GetWorkingGroup() != NULL) {
+      KernelAppend(kernel, wxString::Format(_("Lost connection to Maxima process %d."),
+                                            kernel->GetNumber()), MC_TYPE_ERROR);
+      kernel->m_queue.RemoveFirst();
+    }
+    kernel->Kill();
+    MoveKernelQueue(kernel);
+    // Start the next one if this one didn't get that far
+    LaunchKernel();
+    UpdateKernelStatus();
+    m_console->Refresh();
+    break;
+
+  default:
+    break;
+  }
+}
+
+/***
+ * The cells which wait for a process which is gone are evaluated by the
+ * main one.
+ */
+void wxMaxima::MoveKernelQueue(MaximaKernel *kernel)
+{
+  GroupCell *group;
+  bool moved = false;
+  while ((group = kernel->m_queue.GetFirst()) != NULL)
+  {
+    kernel->m_queue.RemoveFirst();
+    m_console->m_evaluationQueue->AddToQueue(group);
+    moved = true;
+  }
+
+  if (moved && m_isConnected)
+    TryEvaluateNextInQueue();
+}
+
+/***
+ * Stops the additional processes which didn't connect and get through
+ * the setup in KERNEL_TIMEOUT seconds, so that LaunchKernel can start
+ * the next one.
+ */
+void wxMaxima::KernelTimerEvent(wxTimerEvent& event)
+{
+  bool starting = false;
+  bool stopped = false;
+  long now = wxGetLocalTime();
+
+  for (MaximaKernel *kernel = m_kernels; kernel != NULL; kernel = kernel->next)
+    if (kernel->GetState() == MaximaKernel::KERNEL_STARTING ||
+        kernel->GetState() == MaximaKernel::KERNEL_SETUP)
+    {
+      if (now - kernel->GetStarted() < KERNEL_TIMEOUT)
+        starting = true;
+      else {
+        kernel->Kill();
+        MoveKernelQueue(kernel);
+        stopped = true;
+      }
+    }
+
+  if (m_spare != NULL && (m_spare->GetState() == MaximaKernel::KERNEL_STARTING ||
+                          m_spare->GetState() == MaximaKernel::KERNEL_SETUP))
+  {
+    if (now - m_spare->GetStarted() < KERNEL_TIMEOUT)
+      starting = true;
+    else {
+      m_spare->Kill();
+      stopped = true;
+    }
+  }
+
+  if (stopped) {
+    LaunchKernel();
+    UpdateKernelStatus();
+  }
+
+  // LaunchKernel may have started the next one
+  for (MaximaKernel *kernel = m_kernels; kernel != NULL; kernel = kernel->next)
+    if (kernel->GetState() == MaximaKernel::KERNEL_STARTING)
+      starting = true;
+  if (!starting)
+    m_kernelTimer.Stop();
+}
+
 /***
  * ServerEvent is triggered when maxima connects to the socket server.
  */
@@ -595,13 +864,36 @@ void wxMaxima::ServerEvent(wxSocketEvent& event)
     {
       if (m_isConnected) {
         wxSocketBase *tmp = m_server->Accept(false);
+
+        // One of the additional maxima processes connected. Processes
+        // which are started at the same time are all the same, so it
+        // doesn't matter which one gets the connection.
+        MaximaKernel *kernel = m_spare;
+        if (kernel == NULL || kernel->GetState() != MaximaKernel::KERNEL_STARTING ||
+            kernel->GetClient() != NULL)
+        {
+          kernel = m_kernels;
+          while (kernel != NULL &&
+                 (kernel->GetState() != MaximaKernel::KERNEL_STARTING ||
+                  kernel->GetClient() != NULL))
+            kernel = kernel->next;
+        }
+
+        if (kernel != NULL)
+        {
+          tmp->SetEventHandler(*this, kernel_socket_id);
+          kernel->Connect(tmp);
+          return;
+        }
+
         tmp->Close();
         return;
       }
       m_isConnected = true;
       m_client = m_server->Accept(false);
       m_client->SetEventHandler(*this, socket_client_id);
-      m_client->SetNotify(wxSOCKET_INPUT_FLAG | wxSOCKET_LOST_FLAG);
+      m_client->SetNotify(wxSOCKET_INPUT_FLAG | wxSOCKET_OUTPUT_FLAG | wxSOCKET_LOST_FLAG);
+      m_sendQueue.SetSocket(m_client);
       m_client->Notify(true);
 #ifndef __WXMSW__
       ReadProcessOutput();
@@ -647,6 +939,12 @@ bool wxMaxima::StartServer()
     SetStatusText(_("Starting server failed"), 1);
     return false;
   }
+  if (m_port == 0)
+  {
+    wxIPV4address local;
+    m_server->GetLocal(local);
+    m_port = local.Service();
+  }
   SetStatusText(_("Server started"), 1);
   m_server->SetEventHandler(*this, socket_server_id);
   m_server->SetNotify(wxSOCKET_CONNECTION_FLAG);
@@ -663,6 +961,8 @@ bool wxMaxima::StartServer()
 
 bool wxMaxima::StartMaxima()
 {
+  StopKernels();
+
   if (m_isConnected)
   {
     KillMaxima();
@@ -671,95 +971,246 @@ bool wxMaxima::StartMaxima()
   }
 
   m_variablesOK = false;
-  wxString command = GetCommand();;
-
-  if (command.Length() > 0)
-  {
-#if defined(__WXMSW__)
- #if wxCHECK_VERSION(2, 9, 0)
-    if (wxGetOsVersion() == wxOS_WINDOWS_9X)
- #else
-    if (wxGetOsVersion() == wxWIN95)
- #endif
-    {
-      wxString maximaPrefix = command.SubString(1, command.Length() - 3);
-      wxString sysPath;
+  wxString command;
 
-      wxGetEnv(wxT("path"), &sysPath);
-      maximaPrefix.Replace(wxT("\\bin\\maxima.bat"), wxEmptyString);
+  // A replayed session comes through the socket
+  m_stdio = false;
+#if !defined __WXMSW__
+  if (m_replay == NULL)
+    wxConfig::Get()->Read(wxT("useStdio"), &m_stdio);
+#endif
 
-      wxSetEnv(wxT("maxima_prefix"), maximaPrefix);
-      wxSetEnv(wxT("path"), maximaPrefix + wxT("\\bin;") + sysPath);
+  if (m_replay == NULL)
+    command = GetStartCommand(m_stdio);
 
-      command = maximaPrefix + wxT("\\lib\\maxima");
-      if (!wxDirExists(command))
-        return false;
+  if (command.Length() > 0 || m_replay != NULL)
+  {
+    m_first = true;
+    m_framed = false;
+    m_inFlight = 0;
+    m_cancelled = false;
+    m_questionPending = false;
+    m_saveSessionPending = false;
+    m_replaying = 0;
+    m_cacheDebt.Clear();
+    m_resultCache.Reset();
+    m_dependencies.Clear();
+    m_currentOutput.Clear();
+    GetMenuBar()->Enable(menu_interrupt_id, false);
+    m_pid = -1;
 
-      wxArrayString files;
-      wxDir::GetAllFiles(command, &files, wxT("maxima.exe"));
-      if (files.Count() == 0)
-        return false;
-      else
-      {
-        command = files[0];
-        command.Append(wxString::Format(
-                         wxT(" -eval \"(maxima::start-client %d)\" -eval \"(run)\" -f"),
-                         m_port
-                       ));
-      }
+    if (m_replay != NULL)
+    {
+      SetStatusText(_("Replaying session..."), 1);
+      return m_replay->Start(m_port);
     }
-    else
-      command.Append(wxString::Format(wxT(" -s %d"), m_port));
-    wxSetEnv(wxT("home"), wxGetHomeDir());
-    wxSetEnv(wxT("maxima_signals_thread"), wxT("1"));
-#else
-    command.Append(wxString::Format(wxT(" -r \":lisp (setup-client %d)\""),
-                                    m_port));
-#endif
-
-#if defined __WXMAC__
-    wxSetEnv(wxT("DISPLAY"), wxT(":0.0"));
-#endif
 
     m_process = new wxProcess(this, maxima_process_id);
     m_process->Redirect();
-    m_first = true;
-    GetMenuBar()->Enable(menu_interrupt_id, false);
-    m_pid = -1;
     SetStatusText(_("Starting Maxima..."), 1);
-    wxExecute(command, wxEXEC_ASYNC, m_process);
+    long pid = wxExecute(command, wxEXEC_ASYNC, m_process);
     m_input = m_process->GetInputStream();
-    SetStatusText(_("Maxima started. Waiting for connection..."), 1);
+
+    // There is no connection to wait for, maxima reads its input from
+    // the pipe. The pid comes from wxExecute, the first prompt doesn't
+    // print it.
+    if (m_stdio)
+    {
+      if (pid <= 0)
+      {
+        delete m_process;
+        m_process = NULL;
+        return false;
+      }
+#if !defined __WXMSW__
+      // Writing to the pipe of a maxima which is gone must not end
+      // wxMaxima
+      signal(SIGPIPE, SIG_IGN);
+#endif
+      m_pid = pid;
+      m_isConnected = true;
+      m_sendQueue.SetStream(m_process->GetOutputStream());
+      m_stdioTimer.Start(1);
+      SetStatusText(_("Maxima started. Waiting for the first prompt..."), 1);
+    }
+    else
+      SetStatusText(_("Maxima started. Waiting for connection..."), 1);
   }
   else
     return false;
   return true;
 }
 
-
-void wxMaxima::Interrupt(wxCommandEvent& event)
+/***
+ * Returns the command which starts maxima and connects it to our
+ * server, or an empty string if maxima can't be found. With stdio
+ * maxima isn't connected, it talks through its standard input and
+ * output.
+ */
+wxString wxMaxima::GetStartCommand(bool stdio)
 {
-  if (m_pid < 0)
+  wxString command = GetCommand();
+
+  if (command.Length() == 0 || stdio)
+    return command;
+
+#if defined(__WXMSW__)
+ #if wxCHECK_VERSION(2, 9, 0)
+  if (wxGetOsVersion() == wxOS_WINDOWS_9X)
+ #else
+  if (wxGetOsVersion() == wxWIN95)
+ #endif
   {
-    GetMenuBar()->Enable(menu_interrupt_id, false);
-    return ;
+    wxString maximaPrefix = command.SubString(1, command.Length() - 3);
+    wxString sysPath;
+
+    wxGetEnv(wxT("path"), &sysPath);
+    maximaPrefix.Replace(wxT("\\bin\\maxima.bat"), wxEmptyString);
+
+    wxSetEnv(wxT("maxima_prefix"), maximaPrefix);
+    wxSetEnv(wxT("path"), maximaPrefix + wxT("\\bin;") + sysPath);
+
+    command = maximaPrefix + wxT("\\lib\\maxima");
+    if (!wxDirExists(command))
+      return wxEmptyString;
+
+    wxArrayString files;
+    wxDir::GetAllFiles(command, &files, wxT("maxima.exe"));
+    if (files.Count() == 0)
+      return wxEmptyString;
+    else
+    {
+      command = files[0];
+      command.Append(wxString::Format(
+                       wxT(" -eval \"(maxima::start-client %d)\" -eval \"(run)\" -f"),
+                       m_port
+                     ));
+    }
+  }
+  else
+    command.Append(wxString::Format(wxT(" -s %d"), m_port));
+  wxSetEnv(wxT("home"), wxGetHomeDir());
+  wxSetEnv(wxT("maxima_signals_thread"), wxT("1"));
+#else
+  command.Append(wxString::Format(wxT(" -r \":lisp (setup-client %d)\""),
+                                  m_port));
+#endif
+
+#if defined __WXMAC__
+  wxSetEnv(wxT("DISPLAY"), wxT(":0.0"));
+#endif
+
+  return command;
+}
+
+
+void wxMaxima::Interrupt(wxCommandEvent& event)
+{
+  for (MaximaKernel *kernel = m_kernels; kernel != NULL; kernel = kernel->next)
+    if (kernel->GetState() == MaximaKernel::KERNEL_BUSY && kernel->GetPid() > 0)
+      InterruptProcess(kernel->GetPid());
+
+  if (m_pid < 0)
+  {
+    GetMenuBar()->Enable(menu_interrupt_id, false);
+    return ;
+  }
+
+  if (m_console->GetWorkingGroup() != NULL && !m_atPrompt)
+    CancelOutput();
+
+  // The state of maxima after the interrupt can't be reproduced
+  if (m_console->GetWorkingGroup() != NULL) {
+    for (int i = 1; i < m_inFlight; i++)
+      m_resultCache.Forget(m_console->m_evaluationQueue->GetAt(i));
+    m_resultCache.Interrupted(m_console->GetWorkingGroup());
+  }
+
+  InterruptProcess(m_pid);
+}
+
+/***
+ * Throws away the output of the command maxima is evaluating. Output
+ * which is already waiting to be parsed is cancelled and the text
+ * maxima sends until the next prompt is skipped without parsing it.
+ */
+void wxMaxima::CancelOutput()
+{
+  m_cancelled = true;
+  m_discarded = 0;
+
+  if (m_parserThread != NULL)
+    m_parserThread->CancelOutput();
+
+  m_outputBudget.Reset();
+
+  ReadOutput();
+}
+
+/***
+ * Skips the output of an interrupted command. Returns true when the
+ * prompt after it has arrived.
+ */
+bool wxMaxima::SkipCancelledOutput()
+{
+  wxString token = m_framed ? wxString(wxT("\x02P")) : m_promptPrefix;
+
+  if (!m_currentOutput.SkipTo(token, &m_discarded))
+    return false;
+
+  m_cancelled = false;
+  if (m_discarded > 0)
+    QueueJob(new ParserJob(ParserJob::JOB_OUTPUT,
+                           wxString::Format(_("<< Evaluation interrupted, %ld characters of output were discarded >>"),
+                                            m_discarded)));
+  return true;
+}
+
+/***
+ * Reads everything complete in m_currentOutput.
+ */
+void wxMaxima::ReadOutput()
+{
+  if (m_cancelled && !SkipCancelledOutput())
+    return;
+
+  if (m_framed)
+    ReadFramed();
+
+  else {
+    ReadLoadSymbols();
+
+    ReadMath();
+
+    ReadPrompt();
+
+    ReadFramingAck();
   }
+
+  ReadLispError();
+}
+
+void wxMaxima::InterruptProcess(long pid)
+{
 #if defined (__WXMSW__)
   wxString path, maxima = GetCommand(false);
   wxArrayString out;
   maxima = maxima.SubString(2, maxima.Length() - 3);
   wxFileName::SplitPath(maxima, &path, NULL, NULL);
   wxString command = wxT("\"") + path + wxT("\\winkill.exe\"");
-  command += wxString::Format(wxT(" -INT %ld"), m_pid);
+  command += wxString::Format(wxT(" -INT %ld"), pid);
   wxExecute(command, out);
 #else
-  wxProcess::Kill(m_pid, wxSIGINT);
+  wxProcess::Kill(pid, wxSIGINT);
 #endif
 }
 
 void wxMaxima::KillMaxima()
 {
-  m_process->Detach();
+  // A process which was swapped in by SwapInSpare was not started with m_process
+  if (m_process != NULL)
+    m_process->Detach();
+  m_process = NULL;
   if (m_pid < 0)
   {
     if (m_inLispMode)
@@ -769,10 +1220,35 @@ void wxMaxima::KillMaxima()
     return ;
   }
   wxProcess::Kill(m_pid, wxSIGKILL);
+
+  // The pipes go away with the detached process. The writer is
+  // stopped after the kill, which ends a write maxima doesn't read.
+  if (m_stdio) {
+    m_stdioTimer.Stop();
+    m_sendQueue.SetStream(NULL);
+  }
 }
 
 void wxMaxima::OnProcessEvent(wxProcessEvent& event)
 {
+  // With m_stdio this is the lost connection
+  if (m_stdio && m_isConnected)
+  {
+    ReadStdio();
+    m_stdioTimer.Stop();
+    m_sendQueue.SetStream(NULL);
+    if (!m_closing)
+      ConsoleAppend(wxT("\nMaxima process terminated.\n"
+                        "Restart Maxima with 'Maxima->Restart Maxima'.\n"),
+                    MC_TYPE_ERROR);
+    m_console->SetWorkingGroup(NULL);
+    m_pid = -1;
+    GetMenuBar()->Enable(menu_interrupt_id, false);
+    m_isConnected = false;
+    if (m_batchMode && !m_closing)
+      FinishBatch(2);
+  }
+
   if (!m_closing)
     SetStatusText(_("Maxima process terminated."), 1);
 
@@ -785,6 +1261,12 @@ void wxMaxima::OnProcessEvent(wxProcessEvent& event)
 
 void wxMaxima::CleanUp()
 {
+  if (m_parserThread)
+    StopParserThread(false);
+  StopKernels();
+  if (m_spare != NULL)
+    delete m_spare;
+  m_spare = NULL;
   if (m_client)
     m_client->Notify(false);
   if (m_isConnected)
@@ -799,21 +1281,30 @@ void wxMaxima::CleanUp()
 
 void wxMaxima::ReadFirstPrompt()
 {
-#if defined(__WXMSW__)
-  int start = m_currentOutput.Find(wxT("Maxima"));
-  if (start == -1)
-    start = 0;
-  FirstOutput(wxT("wxMaxima ")
-              wxT(VERSION)
-              wxT(" http://andrejv.github.com/wxmaxima/\n") +
-              m_currentOutput.SubString(start, m_currentOutput.Length() - 1));
-#endif // __WXMSW__
+  wxString output = m_currentOutput.GetText();
 
-  int s = m_currentOutput.Find(wxT("pid=")) + 4;
-  int t = s + m_currentOutput.SubString(s, m_currentOutput.Length()).Find(wxT("\n")) - 1;
+  // Otherwise the banner was read by ReadProcessOutput
+#if defined(__WXMSW__)
+  bool banner = true;
+#else
+  bool banner = m_stdio;
+#endif
+  if (banner)
+  {
+    int start = output.Find(wxT("Maxima"));
+    if (start == -1)
+      start = 0;
+    FirstOutput(wxT("wxMaxima ")
+                wxT(VERSION)
+                wxT(" http://andrejv.github.com/wxmaxima/\n") +
+                output.SubString(start, output.Length() - 1));
+  }
 
-  if (s < t)
-    m_currentOutput.SubString(s, t).ToLong(&m_pid);
+  if (!m_stdio)
+    m_pid = ReadPid(output);
+  // The process of a replayed session is long gone
+  if (m_replay != NULL)
+    m_pid = -1;
 
   if (m_pid > 0)
     GetMenuBar()->Enable(menu_interrupt_id, true);
@@ -822,23 +1313,43 @@ void wxMaxima::ReadFirstPrompt()
   m_inLispMode = false;
   SetStatusText(_("Ready for user input"), 1);
   m_closing = false; // when restarting maxima this is temporarily true
-  m_currentOutput = wxEmptyString;
+  m_currentOutput.Clear();
   m_console->EnableEdit(true);
 
-  if (m_openFile.Length())
+  if (m_batchMode)
+    StartBatch();
+  else if (m_openFile.Length())
   {
     OpenFile(m_openFile);
     m_openFile = wxEmptyString;
   }
-  else if (m_console->m_evaluationQueue->Empty())
+  else
   {
-    bool open = false;
-    wxConfig::Get()->Read(wxT("openHCaret"), &open);
-    if (open)
-      m_console->OpenNextOrCreateCell();
+    // Maxima was restarted
+    RestoreSession();
+
+    if (m_console->m_evaluationQueue->Empty())
+    {
+      bool open = false;
+      wxConfig::Get()->Read(wxT("openHCaret"), &open);
+      if (open)
+        m_console->OpenNextOrCreateCell();
+    }
   }
 }
 
+long wxMaxima::ReadPid(wxString output)
+{
+  long pid = -1;
+  int s = output.Find(wxT("pid=")) + 4;
+  int t = s + output.SubString(s, output.Length()).Find(wxT("\n")) - 1;
+
+  if (s < t)
+    output.SubString(s, t).ToLong(&pid);
+
+  return pid;
+}
+
 /***
  * Checks if maxima displayed a new chunk of math
  */
@@ -850,9 +1361,8 @@ void wxMaxima::ReadMath()
   {
     m_readingPrompt = true;
     wxString o = m_currentOutput.Left(end);
+    m_currentOutput.Consume(end + m_promptPrefix.Length());
     ConsoleAppend(o, MC_TYPE_DEFAULT);
-    m_currentOutput = m_currentOutput.SubString(end + m_promptPrefix.Length(),
-                      m_currentOutput.Length());
     end = m_currentOutput.Find(m_promptPrefix);
   }
 
@@ -864,9 +1374,8 @@ void wxMaxima::ReadMath()
   while (end > -1)
   {
     wxString o = m_currentOutput.Left(end);
+    m_currentOutput.Consume(end + mth.Length());
     ConsoleAppend(o + mth, MC_TYPE_DEFAULT);
-    m_currentOutput = m_currentOutput.SubString(end + mth.Length(),
-                      m_currentOutput.Length());
     end = m_currentOutput.Find(mth);
   }
 }
@@ -879,13 +1388,10 @@ void wxMaxima::ReadLoadSymbols()
     int end = m_currentOutput.Find(wxT("</wxxml-symbols>"));
     if (end > -1)
     {
-      wxString symbols = m_currentOutput.SubString(start + 15, end - 1);
-      m_currentOutput = m_currentOutput.SubString(0, start-1) +
-                        m_currentOutput.SubString(end + 16, m_currentOutput.Length());
+      wxString symbols = m_currentOutput.Mid(start + 15, end - start - 15);
+      m_currentOutput.Erase(start, end + 16 - start);
 
-      wxStringTokenizer templates(symbols, wxT("$"));
-      while (templates.HasMoreTokens())
-        m_console->AddSymbol(templates.GetNextToken());
+      AddSymbols(symbols);
 
       start = m_currentOutput.Find(wxT("<wxxml-symbols>"));
     }
@@ -894,69 +1400,237 @@ void wxMaxima::ReadLoadSymbols()
   }
 }
 
+void wxMaxima::AddSymbols(wxString symbols)
+{
+  wxStringTokenizer templates(symbols, wxT("$"));
+  while (templates.HasMoreTokens())
+    m_console->AddSymbol(templates.GetNextToken());
+}
+
+/***
+ * Checks if maxima acknowledged the switch to framed output. Everything
+ * after the acknowledgement is read by ReadFramed.
+ */
+void wxMaxima::ReadFramingAck()
+{
+  static const wxString ack = wxT("\x02") wxT("A1:1") wxT("\x03");
+  int start = m_currentOutput.Find(ack);
+  if (start > -1)
+  {
+    m_readingPrompt = false;
+    m_framed = true;
+    m_currentOutput.Erase(start, ack.Length());
+    ReadFramed();
+    if (m_kernels == NULL)
+      StartKernels();
+    StartSpare();
+  }
+}
+
+/***
+ * Reads the output in framed mode. Text outside of records is
+ * displayed as it is.
+ */
+void wxMaxima::ReadFramed()
+{
+  wxChar type;
+  wxString data;
+
+  while (true)
+  {
+    switch (m_currentOutput.NextRecord(&type, &data))
+    {
+    case OutputScanner::SCAN_TEXT:
+      ConsoleAppend(data, MC_TYPE_DEFAULT);
+      break;
+    case OutputScanner::SCAN_RECORD:
+      HandleRecord(type, data);
+      break;
+    default:
+      return ;
+    }
+  }
+}
+
+void wxMaxima::HandleRecord(wxChar type, wxString payload)
+{
+  switch (type)
+  {
+  case wxT('M'):
+  case wxT('I'):
+    ConsoleAppend(payload, MC_TYPE_DEFAULT);
+    break;
+  case wxT('E'):
+    if (m_batchMode)
+      m_batchErrors++;
+    // The error of a cell taken from the cache is already displayed
+    if (m_replaying == 0)
+      ConsoleAppend(payload, MC_TYPE_ERROR);
+    break;
+  case wxT('P'):
+    FlushOutputTail();
+    QueueJob(new ParserJob(ParserJob::JOB_PROMPT, payload));
+    break;
+  case wxT('S'):
+    AddSymbols(payload);
+    break;
+  case wxT('Q'):
+    SendAnswerMark();
+    break;
+  default:
+    break;
+  }
+}
+
 /***
- * Checks if maxima displayed a new prompt.
+ * Checks if maxima displayed a new prompt. The prompt is handled after
+ * the output before it has been added to the document.
  */
 void wxMaxima::ReadPrompt()
 {
-  bool ready = true;
   int end = m_currentOutput.Find(m_promptSuffix);
   if (end > -1)
   {
     m_readingPrompt = false;
     wxString o = m_currentOutput.Left(end);
-    if (o != wxT("\n") && o.Length())
+    m_currentOutput.Consume(end + m_promptSuffix.Length());
+    FlushOutputTail();
+    QueueJob(new ParserJob(ParserJob::JOB_PROMPT, o));
+  }
+}
+
+/***
+ * Adds the output which was kept after the output limit was reached
+ * to the document, together with the number of lines which were not
+ * displayed.
+ */
+void wxMaxima::FlushOutputTail()
+{
+  if (!m_outputBudget.IsOverflowing()) {
+    m_outputBudget.Reset();
+    return;
+  }
+
+  long dropped = m_outputBudget.GetDroppedLines();
+  wxArrayString tail = m_outputBudget.TakeTail();
+
+  if (dropped > 0)
+    QueueJob(new ParserJob(ParserJob::JOB_OUTPUT,
+                           wxString::Format(_("<< Output limit reached, %ld lines were not displayed >>"), dropped),
+                           MC_TYPE_DEFAULT));
+
+  for (unsigned int i = 0; i < tail.GetCount(); i++)
+    QueueJob(new ParserJob(ParserJob::JOB_OUTPUT, tail[i], MC_TYPE_DEFAULT));
+}
+
+void wxMaxima::HandlePrompt(wxString o)
+{
+  bool ready = true;
+  if (o != wxT("\n") && o.Length())
+  {
+    // Maxima displayed a new main prompt
+    if (o.StartsWith(wxT("(%i")))
     {
-      // Maxima displayed a new main prompt
-      if (o.StartsWith(wxT("(%i")))
-      {
-        //m_lastPrompt = o.Mid(1,o.Length()-1);
-        //m_lastPrompt.Replace(wxT(")"), wxT(":"), false);
-        m_lastPrompt = o;
-        m_console->m_evaluationQueue->RemoveFirst(); // remove it from queue
-
-        if (m_console->m_evaluationQueue->Empty()) { // queue empty?
-          m_console->ShowHCaret();
-          m_console->SetWorkingGroup(NULL);
-          m_console->Refresh();
-        }
-        else { // we don't have an empty queue
-          m_console->Refresh();
-          m_console->EnableEdit();
-          ready = false;
+      //m_lastPrompt = o.Mid(1,o.Length()-1);
+      //m_lastPrompt.Replace(wxT(")"), wxT(":"), false);
+      m_lastPrompt = o;
+      m_questionPending = false;
+
+      // The input of cells taken from the cache was evaluated
+      if (m_replaying > 0) {
+        m_replaying--;
+        if (m_replaying == 0)
           TryEvaluateNextInQueue();
-        }
-
-        m_console->EnableEdit();
+        return;
+      }
 
-        if (m_console->m_evaluationQueue->Empty())
-        {
-          bool open = false;
-          wxConfig::Get()->Read(wxT("openHCaret"), &open);
-          if (open)
-            m_console->OpenNextOrCreateCell();
+      if (m_console->m_evaluationQueue->GetFirst() != NULL) {
+        TimeEvaluated(m_console->m_evaluationQueue->GetFirst());
+        m_resultCache.Store(m_console->m_evaluationQueue->GetFirst());
+        m_dependencies.Evaluated(m_console->m_evaluationQueue->GetFirst());
+      }
+      m_console->m_evaluationQueue->RemoveFirst(); // remove it from queue
+      if (m_inFlight > 0)
+        m_inFlight--;
+      m_runCells++;
+      if (m_batchMode)
+        ReportBatchCell();
+
+      if (m_console->m_evaluationQueue->Empty()) { // queue empty?
+        m_inFlight = 0;
+        m_runTime = m_runTimer.Time();
+        m_console->ShowHCaret();
+        m_console->SetWorkingGroup(NULL);
+        m_console->Refresh();
+        if (m_batchMode) {
+          FinishBatch(0);
+          return;
         }
+        if (m_saveSessionPending)
+          SaveSession();
+      }
+      else if (m_inFlight > 0) { // the next cell was already sent
+        GroupCell *group = m_console->m_evaluationQueue->GetFirst();
+        m_console->SetWorkingGroup(group);
+        group->StartTiming();
+        group->GetPrompt()->SetValue(m_lastPrompt);
+        m_console->Recalculate();
+        m_console->ScrollToCell(group);
+        SetStatusText(_("Maxima is calculating"), 1);
+        ready = false;
+        SendAhead();
+      }
+      else { // we don't have an empty queue
+        m_console->Refresh();
+        m_console->EnableEdit();
+        ready = false;
+        TryEvaluateNextInQueue();
       }
 
-      // We have a question
-      else {
-        if (o.Find(wxT("<mth>")) > -1)
-          DoConsoleAppend(o, MC_TYPE_PROMPT);
-        else
-          DoRawConsoleAppend(o, MC_TYPE_PROMPT);
+      m_console->EnableEdit();
+
+      if (m_console->m_evaluationQueue->Empty())
+      {
+        bool open = false;
+        wxConfig::Get()->Read(wxT("openHCaret"), &open);
+        if (open)
+          m_console->OpenNextOrCreateCell();
       }
+    }
+
+    // We have a question; nobody can answer it in batch mode
+    else if (m_batchMode) {
+      ReportError(_("Maxima asked a question: ") + o, _("Error"));
+      FinishBatch(4);
+      return;
+    }
 
-      if (o.StartsWith(wxT("\nMAXIMA>")))
-        m_inLispMode = true;
+    else {
+      // Nothing more is sent until the question is answered. The
+      // output depends on the answer, so it is not stored. Maxima
+      // drops the cells sent ahead when it reads the answer, they are
+      // sent again after the next prompt.
+      m_questionPending = true;
+      if (m_inFlight > 1) {
+        m_resultCache.Rewind(m_console->m_evaluationQueue->GetFirst());
+        m_inFlight = 1;
+        m_console->m_evaluationQueue->Pin(1);
+      }
+      m_resultCache.Forget(m_console->m_evaluationQueue->GetFirst());
+      if (o.Find(wxT("<mth>")) > -1)
+        DoConsoleAppend(o, MC_TYPE_PROMPT);
       else
-        m_inLispMode = false;
+        DoRawConsoleAppend(o, MC_TYPE_PROMPT);
     }
 
-    if (ready)
-      SetStatusText(_("Ready for user input"), 1);
-    m_currentOutput = m_currentOutput.SubString(end + m_promptSuffix.Length(),
-                      m_currentOutput.Length());
+    if (o.StartsWith(wxT("\nMAXIMA>")))
+      m_inLispMode = true;
+    else
+      m_inLispMode = false;
   }
+
+  if (ready)
+    SetStatusText(_("Ready for user input"), 1);
 }
 
 // OpenWXM(X)File
@@ -974,7 +1648,7 @@ bool wxMaxima::OpenWXMFile(wxString file, MathCtrl *document, bool clearDocument
   if (!inputFile.Open()) {
     wxEndBusyCursor();
     document->Thaw();
-    wxMessageBox(_("wxMaxima encountered an error loading ") + file, _("Error"), wxOK | wxICON_EXCLAMATION);
+    ReportError(_("wxMaxima encountered an error loading ") + file, _("Error"), wxOK | wxICON_EXCLAMATION);
     SetStatusText(_("Ready for user input"), 1);
     return false;
   }
@@ -985,7 +1659,7 @@ bool wxMaxima::OpenWXMFile(wxString file, MathCtrl *document, bool clearDocument
     inputFile.Close();
     wxEndBusyCursor();
     document->Thaw();
-    wxMessageBox(_("wxMaxima encountered an error loading ") + file, _("Error"), wxOK | wxICON_EXCLAMATION);
+    ReportError(_("wxMaxima encountered an error loading ") + file, _("Error"), wxOK | wxICON_EXCLAMATION);
     SetStatusText(_("Ready for user input"), 1);
     return false;
   }
@@ -1044,7 +1718,7 @@ bool wxMaxima::OpenWXMXFile(wxString file, MathCtrl *document, bool clearDocumen
     wxEndBusyCursor();
     document->Thaw();
     delete fsfile;
-    wxMessageBox(_("wxMaxima encountered an error loading ") + file, _("Error"),
+    ReportError(_("wxMaxima encountered an error loading ") + file, _("Error"),
         wxOK | wxICON_EXCLAMATION);
     SetStatusText(_("Ready for user input"), 1);
     return false;
@@ -1056,7 +1730,7 @@ bool wxMaxima::OpenWXMXFile(wxString file, MathCtrl *document, bool clearDocumen
   if (xmldoc.GetRoot()->GetName() != wxT("wxMaximaDocument")) {
     wxEndBusyCursor();
     document->Thaw();
-    wxMessageBox(_("wxMaxima encountered an error loading ") + file, _("Error"),
+    ReportError(_("wxMaxima encountered an error loading ") + file, _("Error"),
         wxOK | wxICON_EXCLAMATION);
     SetStatusText(_("Ready for user input"), 1);
     return false;
@@ -1076,7 +1750,7 @@ bool wxMaxima::OpenWXMXFile(wxString file, MathCtrl *document, bool clearDocumen
     if (version_major > DOCUMENT_VERSION_MAJOR) {
       wxEndBusyCursor();
       document->Thaw();
-      wxMessageBox(_("Document ") + file +
+      ReportError(_("Document ") + file +
           _(" was saved using a newer version of wxMaxima. Please update your wxMaxima."),
           _("Error"), wxOK | wxICON_EXCLAMATION);
       SetStatusText(_("Ready for user input"), 1);
@@ -1084,7 +1758,7 @@ bool wxMaxima::OpenWXMXFile(wxString file, MathCtrl *document, bool clearDocumen
     }
     if (version_minor > DOCUMENT_VERSION_MINOR) {
       wxEndBusyCursor();
-      wxMessageBox(_("Document ") + file +
+      ReportError(_("Document ") + file +
           _(" was saved using a newer version of wxMaxima so it may not load correctly. Please update your wxMaxima."),
           _("Warning"), wxOK | wxICON_EXCLAMATION);
       wxBeginBusyCursor();
@@ -1102,6 +1776,17 @@ bool wxMaxima::OpenWXMXFile(wxString file, MathCtrl *document, bool clearDocumen
 
   GroupCell *tree = CreateTreeFromXMLNode(xmlcells, file);
 
+  // The outputs in the cache of the document, see ResultCache
+  if (m_resultCache.IsEnabled()) {
+    fsfile = fs.OpenFile(wxT("file:") + file + wxT("#zip:cache.xml"));
+    wxXmlDocument cachedoc;
+    if (fsfile != NULL && cachedoc.Load(*(fsfile->GetStream()))) {
+      MathParser mp(file);
+      m_resultCache.Load(cachedoc.GetRoot(), mp);
+    }
+    delete fsfile;
+  }
+
   // from here on code is identical for wxm and wxmx
   if (clearDocument) {
     document->ClearDocument();
@@ -1153,7 +1838,7 @@ GroupCell* wxMaxima::CreateTreeFromXMLNode(wxXmlNode *xmlcells, wxString wxmxfil
       }
       else if (warning)
       {
-        wxMessageBox(_("Parts of the document will not be loaded correctly!"), _("Warning"),
+        ReportError(_("Parts of the document will not be loaded correctly!"), _("Warning"),
           wxOK | wxICON_WARNING);
         warning = false;
       }
@@ -1346,7 +2031,7 @@ void wxMaxima::ReadLispError()
     ConsoleAppend(o, MC_TYPE_DEFAULT);
     ConsoleAppend(lispError, MC_TYPE_PROMPT);
     SetStatusText(_("Ready for user input"), 1);
-    m_currentOutput = wxEmptyString;
+    m_currentOutput.Clear();
   }
 }
 
@@ -1354,7 +2039,7 @@ void wxMaxima::ReadLispError()
 void wxMaxima::ReadProcessOutput()
 {
   wxString o;
-  while (m_process->IsInputAvailable())
+  while (m_process != NULL && m_process->IsInputAvailable())
     o += m_input->GetC();
 
   int st = o.Find(wxT("Maxima"));
@@ -1376,31 +2061,46 @@ void wxMaxima::ReadProcessOutput()
  */
 void wxMaxima::SetupVariables()
 {
-  SendMaxima(wxT(":lisp-quiet (setf *prompt-suffix* \"") +
-             m_promptSuffix +
-             wxT("\")"));
-  SendMaxima(wxT(":lisp-quiet (setf *prompt-prefix* \"") +
-             m_promptPrefix +
-             wxT("\")"));
-  SendMaxima(wxT(":lisp-quiet (setf $in_netmath nil)"));
-  SendMaxima(wxT(":lisp-quiet (setf $show_openplot t)"));
+  wxArrayString commands = GetSetupCommands();
+  for (unsigned int i = 0; i < commands.GetCount(); i++)
+    SendMaxima(commands[i]);
+
+  // Older versions of wxmathml.lisp don't know about framed output
+  bool framed = false;
+  wxConfig::Get()->Read(wxT("framedOutput"), &framed);
+  if (framed)
+    SendMaxima(wxT(":lisp-quiet (if (fboundp 'wx-set-framing) (wx-set-framing t))"));
+}
+
+wxArrayString wxMaxima::GetSetupCommands()
+{
+  wxArrayString commands;
+  commands.Add(wxT(":lisp-quiet (setf *prompt-suffix* \"") +
+               m_promptSuffix +
+               wxT("\")"));
+  commands.Add(wxT(":lisp-quiet (setf *prompt-prefix* \"") +
+               m_promptPrefix +
+               wxT("\")"));
+  commands.Add(wxT(":lisp-quiet (setf $in_netmath nil)"));
+  commands.Add(wxT(":lisp-quiet (setf $show_openplot t)"));
 #if defined (__WXMSW__)
   wxString cwd = wxGetCwd();
   cwd.Replace(wxT("\\"), wxT("/"));
-  SendMaxima(wxT(":lisp-quiet ($load \"") + cwd + wxT("/data/wxmathml\")"));
+  commands.Add(wxT(":lisp-quiet ($load \"") + cwd + wxT("/data/wxmathml\")"));
 #elif defined (__WXMAC__)
   wxString cwd = wxGetCwd();
   cwd = cwd + wxT("/") + wxT(MACPREFIX);
-  SendMaxima(wxT(":lisp-quiet ($load \"") + cwd + wxT("wxmathml\")"));
+  commands.Add(wxT(":lisp-quiet ($load \"") + cwd + wxT("wxmathml\")"));
   // check for Gnuplot.app - use it if it exists
   wxString gnuplotbin(wxT("/Applications/Gnuplot.app/Contents/Resources/bin/gnuplot"));
   if (wxFileExists(gnuplotbin))
-    SendMaxima(wxT(":lisp-quiet (setf $gnuplot_command \"") + gnuplotbin + wxT("\")"));
+    commands.Add(wxT(":lisp-quiet (setf $gnuplot_command \"") + gnuplotbin + wxT("\")"));
 #else
   wxString prefix = wxT(PREFIX);
-  SendMaxima(wxT(":lisp-quiet ($load \"") + prefix +
-             wxT("/share/wxMaxima/wxmathml\")"));
+  commands.Add(wxT(":lisp-quiet ($load \"") + prefix +
+               wxT("/share/wxMaxima/wxmathml\")"));
 #endif
+  return commands;
 }
 
 ///--------------------------------------------------------------------------------
@@ -1421,10 +2121,10 @@ wxString wxMaxima::GetCommand(bool params)
     config->Read(wxT("maxima"), &maxima);
     if (!wxFileExists(maxima))
     {
-      wxMessageBox(_("wxMaxima could not find Maxima!\n\n"
-                     "Please configure wxMaxima with 'Edit->Configure'.\n"
-                     "Then start Maxima with 'Maxima->Restart Maxima'."), _("Warning"),
-                   wxOK | wxICON_EXCLAMATION);
+      ReportError(_("wxMaxima could not find Maxima!\n\n"
+                    "Please configure wxMaxima with 'Edit->Configure'.\n"
+                    "Then start Maxima with 'Maxima->Restart Maxima'."), _("Warning"),
+                  wxOK | wxICON_EXCLAMATION);
       SetStatusText(_("Please configure wxMaxima with 'Edit->Configure'."));
       return wxEmptyString;
     }
@@ -1638,6 +2338,9 @@ void wxMaxima::MenuCommand(wxString cmd)
 
 void wxMaxima::DumpProcessOutput()
 {
+  if (m_process == NULL)
+    return;
+
   wxString o;
   while (m_process->IsInputAvailable())
   {
@@ -1726,6 +2429,9 @@ void wxMaxima::UpdateMenus(wxUpdateUIEvent& event)
 //  else
 //    menubar->Enable(menu_evaluate, m_console->GetActiveCell() != NULL);
   menubar->Enable(menu_evaluate_all, m_console->GetTree() != NULL);
+  menubar->Enable(menu_evaluate_parallel, m_console->GetTree() != NULL);
+  menubar->Enable(menu_evaluate_stale, m_console->GetTree() != NULL);
+  menubar->Enable(menu_evaluation_times, m_console->GetTree() != NULL);
   menubar->Enable(menu_save_id, !m_fileSaved);
 
   for (int id = menu_pane_math; id<=menu_pane_stats; id++)
@@ -1813,11 +2519,15 @@ void wxMaxima::OpenFile(wxString file, wxString cmd)
       MenuCommand(cmd + wxT("(\"") + unixFilename + wxT("\")$"));
     }
 
-    else if (file.Right(4) == wxT(".wxm"))
-      OpenWXMFile(file, m_console);
+    else if (file.Right(4) == wxT(".wxm")) {
+      if (OpenWXMFile(file, m_console))
+        RestoreSession();
+    }
 
-    else if (file.Right(5) == wxT(".wxmx"))
-      OpenWXMXFile(file, m_console); // clearDocument = true
+    else if (file.Right(5) == wxT(".wxmx")) {
+      if (OpenWXMXFile(file, m_console)) // clearDocument = true
+        RestoreSession();
+    }
 
     else if (file.Right(4) == wxT(".dem"))
       MenuCommand(wxT("demo(\"") + unixFilename + wxT("\")$"));
@@ -1876,11 +2586,12 @@ bool wxMaxima::SaveFile(bool forceSave)
     m_currentFile = file;
     m_lastPath = wxPathOnly(file);
     if (file.Right(5) == wxT(".wxmx"))
-      m_console->ExportToWXMX(file);
+      m_console->ExportToWXMX(file, &m_resultCache);
     else
       m_console->ExportToMAC(file);
 
     AddRecentDocument(file);
+    SaveSession();
 
     return true;
   }
@@ -2042,6 +2753,35 @@ void wxMaxima::EditMenu(wxCommandEvent& event)
       if (configW->ShowModal() == wxID_OK)
       {
         configW->WriteSettings();
+        m_MParser.ReadConfig();
+        wxConfig::Get()->Read(wxT("pipelineDepth"), &m_pipelineDepth);
+        m_outputBudget.ReadConfig();
+        m_resultCache.ReadConfig();
+        bool parseInThread = false;
+        wxConfig::Get()->Read(wxT("parseInThread"), &parseInThread);
+        if (parseInThread && m_parserThread == NULL)
+          StartParserThread();
+        else if (!parseInThread && m_parserThread != NULL)
+          StopParserThread(true);
+        if (m_parserThread != NULL)
+          m_parserThread->ReadConfig();
+        int kernelCount = 0, running = 0;
+        wxConfig::Get()->Read(wxT("kernelCount"), &kernelCount);
+        for (MaximaKernel *kernel = m_kernels; kernel != NULL; kernel = kernel->next)
+          running++;
+        if (kernelCount != running && m_isConnected) {
+          StopKernels();
+          StartKernels();
+        }
+        bool warmStandby = false;
+        wxConfig::Get()->Read(wxT("warmStandby"), &warmStandby);
+        if (warmStandby && m_isConnected)
+          StartSpare();
+        else if (!warmStandby && m_spare != NULL) {
+          delete m_spare;
+          m_spare = NULL;
+          UpdateKernelStatus();
+        }
         m_console->RecalculateForce();
         m_console->Refresh();
       }
@@ -2244,7 +2984,8 @@ void wxMaxima::MaximaMenu(wxCommandEvent& event)
     m_closing = true;
     m_console->ClearEvaluationQueue();
     m_console->ResetInputPrompts();
-    StartMaxima();
+    if (!SwapInSpare())
+      StartMaxima();
     break;
   case menu_soft_restart:
     MenuCommand(wxT("kill(all);"));
@@ -2313,6 +3054,20 @@ void wxMaxima::MaximaMenu(wxCommandEvent& event)
     m_console->AddDocumentToEvaluationQueue();
     TryEvaluateNextInQueue();
     break;
+  case menu_evaluate_next:
+    m_console->EvaluateCellNext();
+    if (m_console->GetWorkingGroup() == NULL)
+      TryEvaluateNextInQueue();
+    break;
+  case menu_evaluate_parallel:
+    EvaluateParallel();
+    break;
+  case menu_evaluate_stale:
+    EvaluateStale();
+    break;
+  case menu_evaluation_times:
+    ShowEvaluationTimes();
+    break;
   case menu_clear_var:
     cmd = GetTextFromUser(_("Delete variable(s):"), _("Delete"),
                           wxT("all"), this);
@@ -3787,7 +4542,11 @@ void wxMaxima::OnClose(wxCloseEvent& event)
     }
 
     if (close == wxID_YES) {
-      if (!SaveFile()) {
+      // Maxima is killed below, so SaveFile doesn't save the session
+      m_closing = true;
+      bool saved = SaveFile();
+      m_closing = false;
+      if (!saved) {
         event.Veto();
         return;
       }
@@ -4063,11 +4822,21 @@ void wxMaxima::EvaluateEvent(wxCommandEvent& event)
     // case - answering a question. Manually send answer to Maxima.
     if (tmp->GetParent() == m_console->m_evaluationQueue->GetFirst()) {
       SendMaxima(tmp->ToString(false), true);
+      m_resultCache.Sent(tmp->ToString(false));
+      return;
     }
-    else { // normally just add to queue
-      m_console->AddCellToEvaluationQueue(dynamic_cast<GroupCell*>(tmp->GetParent()));
-      TryEvaluateNextInQueue();
-    }
+    // the same for the additional maxima processes
+    for (MaximaKernel *kernel = m_kernels; kernel != NULL; kernel = kernel->next)
+      if (kernel->GetState() == MaximaKernel::KERNEL_BUSY &&
+          tmp->GetParent() == kernel->GetWorkingGroup()) {
+        wxString answer = tmp->ToString(false);
+        ConvertSpecialChars(answer);
+        kernel->Send(answer);
+        return;
+      }
+    // normally just add to queue
+    m_console->AddCellToEvaluationQueue(dynamic_cast<GroupCell*>(tmp->GetParent()));
+    TryEvaluateNextInQueue();
   }
   else { // no evaluate has been called on no active cell?
     m_console->AddSelectionToEvaluationQueue();
@@ -4080,7 +4849,7 @@ void wxMaxima::EvaluateEvent(wxCommandEvent& event)
 void wxMaxima::TryEvaluateNextInQueue()
 {
   if (!m_isConnected) {
-    wxMessageBox(_("\nNot connected to Maxima!\n"), _("Error"), wxOK | wxICON_ERROR);
+    ReportError(_("\nNot connected to Maxima!\n"), _("Error"), wxOK | wxICON_ERROR);
 
     if (!m_console->m_evaluationQueue->Empty())
     {
@@ -4089,21 +4858,39 @@ void wxMaxima::TryEvaluateNextInQueue()
       DumpProcessOutput();
     }
 
-    while (!m_console->m_evaluationQueue->Empty())
-      m_console->m_evaluationQueue->RemoveFirst();
+    m_console->m_evaluationQueue->Clear();
+    m_inFlight = 0;
 
     m_console->Refresh();
 
+    if (m_batchMode)
+      FinishBatch(2);
     return ;
   }
 
+  // Maxima is busy, the cells added to the queue are sent after the
+  // next prompt
+  if (m_inFlight > 0 || m_replaying > 0)
+    return;
+
+  if (m_resultCache.IsEnabled())
+    TakeFromCache();
+
   GroupCell * group = m_console->m_evaluationQueue->GetFirst();
   if (group == NULL)
   {
     m_console->SetWorkingGroup(NULL);
+    if (m_batchMode)
+      FinishBatch(0);
     return; //empty queue
   }
 
+  if (m_console->GetWorkingGroup() == NULL) { // a new evaluation
+    m_runCells = 0;
+    m_runTime = -1;
+    m_runTimer.Start();
+  }
+
   if (group->GetEditable()->GetValue() != wxEmptyString)
   {
     group->GetEditable()->AddEnding();
@@ -4117,14 +4904,25 @@ void wxMaxima::TryEvaluateNextInQueue()
       return;
     }
 
+    if (!m_cacheDebt.IsEmpty()) {
+      ReplayCacheDebt(group);
+      return;
+    }
+
     group->RemoveOutput();
 
     m_console->SetWorkingGroup(group);
+    m_outputBudget.Reset();
     group->GetPrompt()->SetValue(m_lastPrompt);
     m_console->Recalculate();
     m_console->ScrollToCell(group);
 
+    group->StartTiming();
     SendMaxima(text, true);
+    m_resultCache.Sent(group);
+    m_inFlight = 1;
+    m_console->m_evaluationQueue->Pin(1);
+    SendAhead();
   }
   else
   {
@@ -4133,6 +4931,840 @@ void wxMaxima::TryEvaluateNextInQueue()
   }
 }
 
+/***
+ * Records the session with maxima to the file record and/or replays
+ * the session in the file replay instead of starting maxima. Called
+ * before InitSession.
+ */
+void wxMaxima::SetSession(wxString record, wxString replay, bool fast)
+{
+  if (record.Length() > 0 && !m_recorder.Open(record))
+    ReportError(_("wxMaxima could not open ") + record, _("Error"));
+
+  if (replay.Length() > 0)
+  {
+    m_replay = new SessionReplay(fast);
+    if (!m_replay->Load(replay))
+    {
+      ReportError(_("wxMaxima could not read the session in ") + replay, _("Error"));
+      delete m_replay;
+      m_replay = NULL;
+    }
+  }
+}
+
+/***
+ * Loads the document given on the command line and evaluates all of
+ * its cells. FinishBatch is called when the queue is empty.
+ */
+void wxMaxima::StartBatch()
+{
+  bool loaded = false;
+
+  if (m_openFile.Right(5) == wxT(".wxmx"))
+    loaded = OpenWXMXFile(m_openFile, m_console);
+  else if (m_openFile.Right(4) == wxT(".wxm"))
+    loaded = OpenWXMFile(m_openFile, m_console);
+  else
+    ReportError(_("Only .wxm and .wxmx documents can be evaluated in batch mode."),
+                _("Error"));
+  m_openFile = wxEmptyString;
+
+  if (!loaded) {
+    FinishBatch(1);
+    return;
+  }
+
+  m_console->AddDocumentToEvaluationQueue();
+  m_batchCell = 0;
+  m_batchErrors = 0;
+  m_batchTotal.Start();
+  m_batchTimer.Start();
+  TryEvaluateNextInQueue();
+}
+
+void wxMaxima::ReportBatchCell()
+{
+  m_batchCell++;
+  wxPrintf(wxT("cell %d: %.3f s\n"), m_batchCell, m_batchTimer.Time() / 1000.0);
+  fflush(stdout);
+  m_batchTimer.Start();
+}
+
+/***
+ * Exports the document to the output file, reports the result and
+ * closes the window. The exit code is 0 on success, 1 if the document
+ * could not be loaded or exported, 2 if maxima could not be started or
+ * exited, 3 if some cells ended with an error and 4 if maxima asked a
+ * question.
+ */
+void wxMaxima::FinishBatch(int code)
+{
+  if (!m_batchMode)
+    return;
+
+  if (code != 1 && m_console->GetTree() != NULL)
+  {
+    bool exported;
+    if (m_batchOutput.Right(5) == wxT(".wxmx"))
+      exported = m_console->ExportToWXMX(m_batchOutput);
+    else if (m_batchOutput.Right(5) == wxT(".html"))
+      exported = m_console->ExportToHTML(m_batchOutput);
+    else if (m_batchOutput.Right(4) == wxT(".tex"))
+      exported = m_console->ExportToTeX(m_batchOutput);
+    else
+      exported = m_console->ExportToMAC(m_batchOutput);
+
+    if (!exported) {
+      ReportError(_("Exporting to ") + m_batchOutput + _(" failed!"), _("Error"));
+      code = 1;
+    }
+  }
+
+  if (code == 0 && m_batchErrors > 0)
+    code = 3;
+
+  wxPrintf(wxT("%d cells, %d errors, %.3f s\n"), m_batchCell, m_batchErrors,
+           m_batchTotal.Time() / 1000.0);
+  fflush(stdout);
+
+  // Nothing may report anything or finish the batch again while the
+  // window is closing
+  m_batchMode = false;
+  m_closing = true;
+
+  wxGetApp().SetExitCode(code);
+  CleanUp();
+  Destroy();
+}
+
+/***
+ * Shows the message in a message box, or prints it to stderr in batch
+ * mode where there is nobody to close the box.
+ */
+void wxMaxima::ReportError(wxString message, wxString caption, long style)
+{
+  if (m_batchMode) {
+    message.Trim();
+    message.Trim(false);
+    wxFprintf(stderr, wxT("%s: %s\n"), caption.c_str(), message.c_str());
+  }
+  else
+    wxMessageBox(message, caption, style);
+}
+
+/***
+ * Evaluates the cells which were changed since they were evaluated and
+ * the cells which use what they define.
+ */
+void wxMaxima::EvaluateStale()
+{
+  std::vector<GroupCell*> stale =
+    m_dependencies.GetStaleCells(dynamic_cast<GroupCell*>(m_console->GetTree()));
+
+  int added = 0;
+  for (unsigned int i = 0; i < stale.size(); i++)
+    if (!m_console->IsInAnyQueue(stale[i])) {
+      m_console->m_evaluationQueue->AddToQueue(stale[i]);
+      added++;
+    }
+
+  if (added == 0) {
+    SetStatusText(_("All cells are up to date"), 1);
+    return;
+  }
+
+  if (m_console->GetWorkingGroup() == NULL)
+    TryEvaluateNextInQueue();
+  else
+    m_console->Refresh();
+}
+
+/***
+ * Records that maxima is done with group and its output is in the
+ * document. The layout is recorded when the output is laid out.
+ */
+void wxMaxima::TimeEvaluated(GroupCell *group)
+{
+  group->SetTime(GC_TIME_PARSED);
+  if (m_console->GetOutputGroup() != group)
+    group->SetTime(GC_TIME_LAYOUT);
+}
+
+void wxMaxima::ShowEvaluationTimes()
+{
+  wxString statistics = m_console->GetLayoutStatistics();
+  if (m_runTime >= 0)
+    statistics = wxString::Format(_("Last evaluation: %d cells in %.3f s, %d cells sent at once"),
+                                  m_runCells, m_runTime / 1000.0,
+                                  m_framed ? m_pipelineDepth : 1) +
+                 wxT("\n") + statistics;
+
+  EvaluationTimes *times = new EvaluationTimes(this, -1, _("Evaluation Times"),
+                                               dynamic_cast<GroupCell*>(m_console->GetTree()),
+                                               statistics);
+  if (times->IsEmpty()) {
+    times->Destroy();
+    SetStatusText(_("No cells were evaluated"), 1);
+    return;
+  }
+
+  times->Centre(wxBOTH);
+  if (times->ShowModal() == wxID_OK)
+  {
+    GroupCell *group = times->GetSelection();
+    if (group != NULL) {
+      m_console->SetSelection(group);
+      m_console->ScrollToCell(group);
+    }
+  }
+  times->Destroy();
+}
+
+/***
+ * Takes the output of the cells at the beginning of the queue from the
+ * result cache. Maxima doesn't evaluate them now; their input is kept
+ * and sent by ReplayCacheDebt when a cell which is not in the cache
+ * needs the state they would have created.
+ */
+void wxMaxima::TakeFromCache()
+{
+  GroupCell *group;
+  bool taken = false;
+
+  while ((group = m_console->m_evaluationQueue->GetFirst()) != NULL &&
+         group->GetEditable()->GetValue() != wxEmptyString &&
+         m_resultCache.Has(group))
+  {
+    group->GetEditable()->AddEnding();
+    group->GetEditable()->ContainsChanges(false);
+    m_cacheDebt.Add(group->GetEditable()->ToString(false));
+    m_dependencies.Evaluated(group);
+
+    MathCell *output = m_resultCache.Get(group);
+    m_resultCache.Sent(group);
+    group->RemoveOutput();
+    group->AppendOutput(output);
+    while (output != NULL) {
+      output->SetParent(group, false);
+      output = output->m_next;
+    }
+    group->GetPrompt()->SetValue(m_lastPrompt);
+
+    m_console->m_evaluationQueue->RemoveFirst();
+    taken = true;
+  }
+
+  if (taken)
+  {
+    m_console->Recalculate();
+    m_console->Refresh();
+    SetStatusText(_("Output taken from the cache"), 1);
+  }
+}
+
+/***
+ * Sends the input of the cells which were taken from the cache before
+ * group is evaluated. Their output is not displayed.
+ */
+void wxMaxima::ReplayCacheDebt(GroupCell *group)
+{
+  group->RemoveOutput();
+  m_console->SetWorkingGroup(group);
+  group->GetPrompt()->SetValue(m_lastPrompt);
+  m_console->Recalculate();
+  m_console->ScrollToCell(group);
+
+  m_replaying = m_cacheDebt.GetCount();
+  for (unsigned int i = 0; i < m_cacheDebt.GetCount(); i++)
+    SendMaxima(m_cacheDebt[i]);
+  m_cacheDebt.Clear();
+
+  SetStatusText(_("Evaluating the cells taken from the cache"), 1);
+}
+
+/***
+ * Sends the cells after the working group in the queue, so that maxima
+ * doesn't wait for wxMaxima between cells. The output is matched to the
+ * cells by the main prompts, which come in the same order. Only done
+ * with framed output, and not while maxima waits for an answer. The
+ * cells are marked so that maxima doesn't read them as an answer.
+ */
+void wxMaxima::SendAhead()
+{
+  if (!m_framed || m_questionPending)
+    return;
+
+  while (m_inFlight < m_pipelineDepth)
+  {
+    GroupCell *group = m_console->m_evaluationQueue->GetAt(m_inFlight);
+    if (group == NULL)
+      break;
+
+    // Empty cells, special inputs and cells in the result cache are
+    // handled by TryEvaluateNextInQueue
+    wxString text = group->GetEditable()->GetValue();
+    if (text == wxEmptyString || text.IsSameAs(wxT("wxmaxima_debug_dump_output;")) ||
+        m_resultCache.Has(group))
+      break;
+
+    // The mark would hide :lisp from maxima
+    if (text.StartsWith(wxT(":lisp")))
+      break;
+
+    group->GetEditable()->AddEnding();
+    group->GetEditable()->ContainsChanges(false);
+    text = group->GetEditable()->ToString(false);
+
+    group->RemoveOutput();
+    SendMaxima(text, true, true);
+    m_resultCache.Sent(group);
+    m_inFlight++;
+    m_console->m_evaluationQueue->Pin(m_inFlight);
+  }
+}
+
+/***
+ * Maxima asked a question. It reads its input up to this mark before
+ * it reads the answer and drops the cells sent ahead on the way, see
+ * wx-call-with-answer in wxmathml.lisp. So the answer is never taken
+ * from a cell in the queue.
+ */
+void wxMaxima::SendAnswerMark()
+{
+  static const char mark[] = "/*wx-answer*/\n";
+  m_sendQueue.Write(mark, strlen(mark));
+  m_recorder.Sent(mark, strlen(mark));
+}
+
+///--------------------------------------------------------------------------------
+///  Additional maxima processes
+///--------------------------------------------------------------------------------
+
+/***
+ * Starts the additional maxima processes once the main one is running
+ * with framed output. They are started one after another, so that each
+ * connection can be matched to its process.
+ */
+void wxMaxima::StartKernels()
+{
+  int count = 0;
+  wxConfig::Get()->Read(wxT("kernelCount"), &count);
+  if (count <= 0 || !m_framed || m_replay != NULL)
+    return;
+
+  MaximaKernel *last = NULL;
+  for (int i = 1; i <= count; i++)
+  {
+    MaximaKernel *kernel = new MaximaKernel(i);
+    if (last == NULL)
+      m_kernels = kernel;
+    else
+      last->next = kernel;
+    last = kernel;
+    m_console->AddKernelQueue(&kernel->m_queue);
+  }
+
+  LaunchKernel();
+  UpdateKernelStatus();
+}
+
+void wxMaxima::LaunchKernel()
+{
+  MaximaKernel *kernel = m_kernels;
+  while (kernel != NULL)
+  {
+    if (kernel->GetState() == MaximaKernel::KERNEL_STARTING)
+      return; // wait until it connects
+    if (kernel->GetState() == MaximaKernel::KERNEL_IDLE)
+      break;
+    kernel = kernel->next;
+  }
+  if (kernel == NULL)
+    return;
+
+  if (!LaunchProcess(kernel))
+    LaunchKernel();
+}
+
+bool wxMaxima::LaunchProcess(MaximaKernel *kernel)
+{
+  // Additional processes are always connected to the server
+  wxString command = GetStartCommand(false);
+  long pid = 0;
+  if (command.Length() > 0)
+    pid = wxExecute(command, wxEXEC_ASYNC);
+
+  if (pid <= 0) {
+    kernel->SetState(MaximaKernel::KERNEL_FAILED);
+    return false;
+  }
+
+  kernel->SetPid(pid);
+  kernel->SetState(MaximaKernel::KERNEL_STARTING);
+  if (!m_kernelTimer.IsRunning())
+    m_kernelTimer.Start(5000);
+  return true;
+}
+
+/***
+ * Starts a spare maxima process which replaces the main one when
+ * maxima is restarted.
+ */
+void wxMaxima::StartSpare()
+{
+  bool warmStandby = false;
+  wxConfig::Get()->Read(wxT("warmStandby"), &warmStandby);
+  if (!warmStandby || !m_framed || m_replay != NULL)
+    return;
+
+  if (m_spare != NULL && m_spare->GetState() != MaximaKernel::KERNEL_FAILED)
+    return;
+
+  if (m_spare != NULL)
+    delete m_spare;
+  m_spare = new MaximaKernel(0);
+  LaunchProcess(m_spare);
+  UpdateKernelStatus();
+}
+
+/***
+ * Replaces the main maxima process with the spare one, if it is ready.
+ * The spare already has the setup of the main process, so it is ready
+ * for user input at once. A new spare is started in the background.
+ */
+bool wxMaxima::SwapInSpare()
+{
+  if (m_spare == NULL || m_spare->GetState() != MaximaKernel::KERNEL_READY ||
+      !m_isConnected)
+    return false;
+
+  StopKernels();
+
+  // Don't handle the lost connection of the old process
+  if (m_client != NULL)
+    m_client->Notify(false);
+  KillMaxima();
+  if (m_client != NULL)
+    m_client->Destroy();
+
+  UseKernel(m_spare);
+  m_spare = NULL;
+
+  RestoreSession();
+
+  StartKernels();
+  StartSpare();
+  return true;
+}
+
+/***
+ * Starts the session of a new window with the spare maxima of donor,
+ * so that the window doesn't have to wait for maxima to start. The
+ * donor starts a new spare.
+ */
+bool wxMaxima::TakeSpareFrom(wxMaxima *donor)
+{
+  if (!donor->HasSpare() || m_replay != NULL || m_recorder.IsOpen())
+    return false;
+
+  MaximaKernel *spare = donor->m_spare;
+  donor->m_spare = NULL;
+  donor->StartSpare();
+  donor->UpdateKernelStatus();
+
+  m_maximaVersion = donor->m_maximaVersion;
+  m_lispVersion = donor->m_lispVersion;
+  m_resultCache.SetVersion(m_maximaVersion + m_lispVersion);
+  m_isConnected = true;
+  UseKernel(spare);
+  LoadSymbols();
+
+  if (m_openFile.Length())
+  {
+    OpenFile(m_openFile);
+    m_openFile = wxEmptyString;
+  }
+
+  StartKernels();
+  StartSpare();
+  return true;
+}
+
+/***
+ * Makes the process of kernel the main maxima process. The kernel is
+ * deleted, its process already has the setup of the main process.
+ */
+void wxMaxima::UseKernel(MaximaKernel *kernel)
+{
+  m_pid = kernel->GetPid();
+  m_lastPrompt = kernel->GetLastPrompt();
+  m_client = kernel->TakeClient();
+  m_client->SetEventHandler(*this, socket_client_id);
+  m_sendQueue.SetSocket(m_client);
+  delete kernel;
+
+  m_currentOutput.Clear();
+  m_first = false;
+  m_stdio = false;
+  m_framed = true;
+  m_variablesOK = true;
+  m_inFlight = 0;
+  m_atPrompt = true;
+  m_cancelled = false;
+  m_questionPending = false;
+  m_saveSessionPending = false;
+  m_replaying = 0;
+  m_cacheDebt.Clear();
+  m_resultCache.Reset();
+  m_dependencies.Clear();
+  m_inLispMode = false;
+  m_closing = false;
+  m_console->SetWorkingGroup(NULL);
+  m_console->EnableEdit(true);
+  GetMenuBar()->Enable(menu_interrupt_id, m_pid > 0);
+  SetStatusText(_("Ready for user input"), 1);
+}
+
+///--------------------------------------------------------------------------------
+///  Session snapshots
+///--------------------------------------------------------------------------------
+
+/***
+ * The snapshot is saved next to the document. Its first line holds
+ * the key from GetSessionKey, a snapshot with a different key is not
+ * restored.
+ */
+wxString wxMaxima::GetSessionFile()
+{
+  if (m_currentFile.Length() == 0)
+    return wxEmptyString;
+  return m_currentFile + wxT(".session");
+}
+
+/***
+ * A hash of the path and the modification time of the document and the
+ * maxima and lisp versions. The snapshot is saved after the document,
+ * so a document which was changed outside of this window doesn't get
+ * the old snapshot.
+ */
+wxString wxMaxima::GetSessionKey()
+{
+  wxString modified;
+  if (wxFileExists(m_currentFile))
+    modified << (long)wxFileModificationTime(m_currentFile);
+  return ResultCache::Hash(m_currentFile + wxT("\n") + modified + wxT("\n") +
+                           m_maximaVersion + m_lispVersion);
+}
+
+void wxMaxima::SendQuiet(wxString command)
+{
+  bool atPrompt = m_atPrompt;
+
+  SendMaxima(command);
+
+  // :lisp-quiet doesn't print a prompt
+  m_atPrompt = atPrompt;
+  if (atPrompt)
+    SetStatusText(_("Ready for user input"), 1);
+}
+
+/***
+ * Maxima reads the command from the same input as the cells and the
+ * answers to questions, so it is only sent at the main prompt. Called
+ * while maxima is busy, the snapshot is saved at the next main prompt
+ * with an empty queue. It is not saved when the window is closed,
+ * because maxima is killed before it could write it.
+ */
+void wxMaxima::SaveSession()
+{
+  bool saveSession = false;
+  wxConfig::Get()->Read(wxT("saveSession"), &saveSession);
+
+  m_saveSessionPending = false;
+  if (!saveSession || !m_isConnected || m_first || m_closing ||
+      m_replay != NULL || m_batchMode)
+    return;
+
+  if (!m_atPrompt || m_questionPending || m_console->GetWorkingGroup() != NULL) {
+    m_saveSessionPending = true;
+    return;
+  }
+
+  wxString file = GetSessionFile();
+  if (file.Length() == 0)
+    return;
+
+  wxString key = GetSessionKey();
+#if defined __WXMSW__
+  file.Replace(wxT("\\"), wxT("/"));
+#endif
+  file.Replace(wxT("\""), wxT("\\\""));
+
+  SendQuiet(wxT(":lisp-quiet (if (fboundp 'wx-save-session) (wx-save-session \"") +
+            file + wxT("\" \"") + key + wxT("\"))"));
+}
+
+void wxMaxima::RestoreSession()
+{
+  bool saveSession = false;
+  wxConfig::Get()->Read(wxT("saveSession"), &saveSession);
+
+  // Only at the main prompt, see SaveSession
+  if (!saveSession || !m_isConnected || m_first || !m_atPrompt ||
+      m_questionPending || m_console->GetWorkingGroup() != NULL ||
+      m_replay != NULL || m_batchMode)
+    return;
+
+  wxString file = GetSessionFile();
+  if (file.Length() == 0 || !wxFileExists(file))
+    return;
+
+  // Compare the key without reading the whole snapshot
+  wxString key = wxT(";; wxMaxima session ") + GetSessionKey();
+  wxFFile snapshot(file, wxT("rb"));
+  if (!snapshot.IsOpened())
+    return;
+  char header[64];
+  size_t read = snapshot.Read(header, sizeof(header) - 1);
+  header[read] = 0;
+  snapshot.Close();
+  if (!wxString(header, wxConvUTF8).StartsWith(key + wxT("\n")))
+    return;
+
+#if defined __WXMSW__
+  file.Replace(wxT("\\"), wxT("/"));
+#endif
+  file.Replace(wxT("\""), wxT("\\\""));
+
+  SendQuiet(wxT(":lisp-quiet (if (fboundp 'wx-restore-session) (wx-restore-session \"") +
+            file + wxT("\"))"));
+}
+
+void wxMaxima::StopKernels()
+{
+  m_console->ClearKernelQueues();
+  while (m_kernels != NULL)
+  {
+    MaximaKernel *kernel = m_kernels;
+    m_kernels = kernel->next;
+    delete kernel;
+  }
+  UpdateKernelStatus();
+}
+
+/***
+ * Reads the output of an additional maxima process. It gets the same
+ * setup as the main one and must switch to framed output before it
+ * evaluates cells.
+ */
+void wxMaxima::ReadKernel(MaximaKernel *kernel)
+{
+  if (kernel->GetState() == MaximaKernel::KERNEL_STARTING)
+  {
+    if (kernel->m_output.Find(m_firstPrompt) == -1)
+      return;
+
+    long pid = ReadPid(kernel->m_output.GetText());
+    if (pid > 0)
+      kernel->SetPid(pid);
+    kernel->m_output.Clear();
+    kernel->SetState(MaximaKernel::KERNEL_SETUP);
+
+    wxArrayString commands = GetSetupCommands();
+    for (unsigned int i = 0; i < commands.GetCount(); i++)
+      kernel->Send(commands[i]);
+    kernel->Send(wxT(":lisp-quiet (if (fboundp 'wx-set-framing) (wx-set-framing t))"));
+
+    LaunchKernel();
+    return;
+  }
+
+  if (kernel->GetState() == MaximaKernel::KERNEL_SETUP)
+  {
+    static const wxString ack = wxT("\x02") wxT("A1:1") wxT("\x03");
+    int start = kernel->m_output.Find(ack);
+    if (start == -1)
+      return;
+
+    // The output of the setup commands is not displayed
+    kernel->m_output.Consume(start + ack.Length());
+    kernel->SetState(MaximaKernel::KERNEL_READY);
+    TryEvaluateKernel(kernel);
+  }
+
+  wxChar type;
+  wxString data;
+  while (true)
+  {
+    switch (kernel->m_output.NextRecord(&type, &data))
+    {
+    case OutputScanner::SCAN_TEXT:
+      KernelAppend(kernel, data);
+      break;
+    case OutputScanner::SCAN_RECORD:
+      if (type == wxT('M') || type == wxT('I'))
+        KernelAppend(kernel, data);
+      else if (type == wxT('E'))
+        KernelAppend(kernel, data, MC_TYPE_ERROR);
+      else if (type == wxT('P'))
+        KernelPrompt(kernel, data);
+      else if (type == wxT('S'))
+        AddSymbols(data);
+      else if (type == wxT('Q'))
+        kernel->Send(wxT("/*wx-answer*/"));
+      break;
+    default:
+      return ;
+    }
+  }
+}
+
+/***
+ * Adds output of an additional maxima process to the cell it evaluates.
+ */
+void wxMaxima::KernelAppend(MaximaKernel *kernel, wxString s, int type)
+{
+  GroupCell *group = kernel->GetWorkingGroup();
+  if (group == NULL || kernel->GetState() != MaximaKernel::KERNEL_BUSY)
+    return;
+
+  wxString t(s);
+  t.Trim();
+  t.Trim(false);
+  if (!t.Length())
+    return ;
+
+  group->SetTime(GC_TIME_OUTPUT);
+  HandleJob(new ParserJob(ParserJob::JOB_OUTPUT, s, type), group);
+}
+
+void wxMaxima::KernelPrompt(MaximaKernel *kernel, wxString o)
+{
+  if (o.StartsWith(wxT("(%i")))
+  {
+    kernel->SetLastPrompt(o);
+    if (kernel->GetWorkingGroup() != NULL) {
+      TimeEvaluated(kernel->GetWorkingGroup());
+      kernel->m_queue.RemoveFirst();
+    }
+    kernel->SetWorkingGroup(NULL);
+    TryEvaluateKernel(kernel);
+    return;
+  }
+
+  // A question, it is answered from the cell like for the main process
+  GroupCell *group = kernel->GetWorkingGroup();
+  if (group == NULL || kernel->GetState() != MaximaKernel::KERNEL_BUSY)
+    return;
+
+  MathCell *cell;
+  if (o.Find(wxT("<mth>")) > -1)
+    cell = ParserJob::ParseXml(m_MParser, o, MC_TYPE_PROMPT);
+  else
+    cell = ParserJob::RawCells(o, MC_TYPE_PROMPT);
+  if (cell != NULL)
+    m_console->InsertLine(cell, true, group);
+}
+
+/***
+ * Sends the next cell in the queue of an additional maxima process.
+ */
+void wxMaxima::TryEvaluateKernel(MaximaKernel *kernel)
+{
+  GroupCell *group;
+  while ((group = kernel->m_queue.GetFirst()) != NULL)
+  {
+    if (group->GetEditable()->GetValue() == wxEmptyString)
+    {
+      kernel->m_queue.RemoveFirst();
+      continue;
+    }
+
+    group->GetEditable()->AddEnding();
+    group->GetEditable()->ContainsChanges(false);
+    wxString text = group->GetEditable()->ToString(false);
+
+    group->RemoveOutput();
+    group->GetPrompt()->SetValue(kernel->GetLastPrompt());
+    m_console->Recalculate();
+    m_console->Refresh();
+
+    ConvertSpecialChars(text);
+    kernel->SetWorkingGroup(group);
+    kernel->SetState(MaximaKernel::KERNEL_BUSY);
+    kernel->m_queue.Pin(1);
+    group->StartTiming();
+    kernel->Send(text);
+    UpdateKernelStatus();
+    return;
+  }
+
+  kernel->SetState(MaximaKernel::KERNEL_READY);
+  UpdateKernelStatus();
+  m_console->Refresh();
+}
+
+/***
+ * Evaluates the document with the main and the additional maxima
+ * processes. Each section (or title) is evaluated by one process, the
+ * sections are assigned to the processes in turn. Code before the first
+ * section goes to the main process.
+ */
+void wxMaxima::EvaluateParallel()
+{
+  std::vector<EvaluationQueue*> queues;
+  std::vector<MaximaKernel*> kernels;
+
+  queues.push_back(m_console->m_evaluationQueue);
+  kernels.push_back(NULL);
+  for (MaximaKernel *kernel = m_kernels; kernel != NULL; kernel = kernel->next)
+    if (kernel->IsUsable()) {
+      queues.push_back(&kernel->m_queue);
+      kernels.push_back(kernel);
+    }
+
+  if (queues.size() == 1)
+  {
+    wxMessageBox(_("No additional Maxima processes are running.\n\n"
+                   "Set the number of processes in 'Edit->Configure'\n"
+                   "and restart Maxima with 'Maxima->Restart Maxima'."),
+                 _("Evaluate Sections in Parallel"), wxOK | wxICON_INFORMATION);
+    return;
+  }
+
+  int slot = 0, section = 0;
+  GroupCell *tmp = dynamic_cast<GroupCell*>(m_console->GetTree());
+  while (tmp != NULL)
+  {
+    if (tmp->GetGroupType() == GC_TYPE_TITLE || tmp->GetGroupType() == GC_TYPE_SECTION)
+      slot = ++section % queues.size();
+    else if (!m_console->IsInAnyQueue(tmp))
+      queues[slot]->AddToQueue(tmp);
+    tmp = dynamic_cast<GroupCell*>(tmp->m_next);
+  }
+
+  for (unsigned int i = 1; i < kernels.size(); i++)
+    if (kernels[i]->GetState() == MaximaKernel::KERNEL_READY)
+      TryEvaluateKernel(kernels[i]);
+
+  if (m_console->GetWorkingGroup() == NULL)
+    TryEvaluateNextInQueue();
+  else
+    m_console->Refresh();
+}
+
+void wxMaxima::UpdateKernelStatus()
+{
+  wxString status;
+  if (m_spare != NULL)
+    status = _("spare: ") + m_spare->GetStatus() + wxT("  ");
+  for (MaximaKernel *kernel = m_kernels; kernel != NULL; kernel = kernel->next)
+    status += wxString::Format(wxT("%d: "), kernel->GetNumber()) +
+              kernel->GetStatus() + wxT("  ");
+  SetStatusText(status, 2);
+}
+
 void wxMaxima::InsertMenu(wxCommandEvent& event)
 {
   int type = 0;
@@ -4651,6 +6283,8 @@ BEGIN_EVENT_TABLE(wxMaxima, wxFrame)
 #endif
   EVT_SOCKET(socket_server_id, wxMaxima::ServerEvent)
   EVT_SOCKET(socket_client_id, wxMaxima::ClientEvent)
+  EVT_SOCKET(kernel_socket_id, wxMaxima::KernelEvent)
+  EVT_MENU(parser_thread_id, wxMaxima::OnParserThread)
   EVT_UPDATE_UI(plot_slider_id, wxMaxima::UpdateSlider)
   EVT_UPDATE_UI(menu_copy_from_console, wxMaxima::UpdateMenus)
   EVT_UPDATE_UI(menu_copy_text_from_console, wxMaxima::UpdateMenus)
@@ -4662,6 +6296,9 @@ BEGIN_EVENT_TABLE(wxMaxima, wxFrame)
   EVT_UPDATE_UI(menu_copy_to_file, wxMaxima::UpdateMenus)
   EVT_UPDATE_UI(menu_evaluate, wxMaxima::UpdateMenus)
   EVT_UPDATE_UI(menu_evaluate_all, wxMaxima::UpdateMenus)
+  EVT_UPDATE_UI(menu_evaluate_parallel, wxMaxima::UpdateMenus)
+  EVT_UPDATE_UI(menu_evaluate_stale, wxMaxima::UpdateMenus)
+  EVT_UPDATE_UI(menu_evaluation_times, wxMaxima::UpdateMenus)
   EVT_UPDATE_UI(menu_select_all, wxMaxima::UpdateMenus)
   EVT_UPDATE_UI(menu_undo, wxMaxima::UpdateMenus)
   EVT_UPDATE_UI(menu_pane_hideall, wxMaxima::UpdateMenus)
@@ -4683,6 +6320,8 @@ BEGIN_EVENT_TABLE(wxMaxima, wxFrame)
   EVT_UPDATE_UI(menu_show_toolbar, wxMaxima::UpdateMenus)
   EVT_CLOSE(wxMaxima::OnClose)
   EVT_END_PROCESS(maxima_process_id, wxMaxima::OnProcessEvent)
+  EVT_TIMER(maxima_stdio_timer_id, wxMaxima::StdioEvent)
+  EVT_TIMER(kernel_timer_id, wxMaxima::KernelTimerEvent)
   EVT_MENU(popid_edit, wxMaxima::EditInputMenu)
   EVT_MENU(menu_evaluate, wxMaxima::EvaluateEvent)
   EVT_MENU(menu_add_comment, wxMaxima::InsertMenu)
@@ -4709,6 +6348,10 @@ BEGIN_EVENT_TABLE(wxMaxima, wxFrame)
   EVT_MENU(popid_evaluate, wxMaxima::PopupMenu)
   EVT_MENU(popid_merge_cells, wxMaxima::PopupMenu)
   EVT_MENU(menu_evaluate_all, wxMaxima::MaximaMenu)
+  EVT_MENU(menu_evaluate_next, wxMaxima::MaximaMenu)
+  EVT_MENU(menu_evaluate_parallel, wxMaxima::MaximaMenu)
+  EVT_MENU(menu_evaluate_stale, wxMaxima::MaximaMenu)
+  EVT_MENU(menu_evaluation_times, wxMaxima::MaximaMenu)
   EVT_IDLE(wxMaxima::OnIdle)
   EVT_MENU(menu_remove_output, wxMaxima::EditMenu)
   EVT_MENU_RANGE(menu_recent_document_0, menu_recent_document_9, wxMaxima::OnRecentDocument)
@@ -22,8 +22,18 @@
 
 #include "wxMaximaFrame.h"
 #include "MathParser.h"
+#include "OutputScanner.h"
+#include "ParserThread.h"
+#include "OutputBudget.h"
+#include "MaximaKernel.h"
+#include "ResultCache.h"
+#include "DependencyGraph.h"
+#include "SessionLog.h"
+#include "SingleInstance.h"
+#include "SendQueue.h"
 
 #include <wx/socket.h>
+#include <wx/snglinst.h>
 #include <wx/config.h>
 #include <wx/process.h>
 #include <wx/fdrepdlg.h>
@@ -38,6 +48,7 @@
 #endif
 
 #define SOCKET_SIZE 1024
+#define KERNEL_TIMEOUT 60
 #define DOCUMENT_VERSION_MAJOR 1
 #define DOCUMENT_VERSION_MINOR 1
 
@@ -45,8 +56,19 @@ class MyApp : public wxApp
 {
 public:
   virtual bool OnInit();
+  virtual int OnRun();
+  virtual int OnExit();
   wxLocale m_locale;
   void NewWindow(wxString file = wxEmptyString);
+  void BatchWindow(wxString input, wxString output);
+  void SetExitCode(int code) { m_exitCode = code; }
+  int m_exitCode;
+  wxString m_recordFile;
+  wxString m_replayFile;
+  bool m_replayFast;
+  wxSingleInstanceChecker *m_checker;
+  InstanceServer *m_instanceServer;
+  bool m_passedOn;                  // the file was opened by another instance
 #if defined (__WXMAC__)
   wxWindowList topLevelWindows;
   void OnFileMenu(wxCommandEvent &ev);
@@ -77,12 +99,23 @@ public:
   void ShowTip(bool force);
   wxString GetHelpFile();
   void ShowHelp(wxString keyword = wxEmptyString);
-  void InitSession();
+  // donor is a window whose spare maxima the session can start with
+  void InitSession(wxMaxima *donor = NULL);
+  bool HasSpare()
+  {
+    return m_spare != NULL && m_spare->GetState() == MaximaKernel::KERNEL_READY;
+  }
   void SetOpenFile(wxString file)
   {
     m_openFile = file;
   }
-  void SendMaxima(wxString s, bool history = false);
+  void SetSession(wxString record, wxString replay, bool fast);
+  void SetBatchMode(wxString output)
+  {
+    m_batchMode = true;
+    m_batchOutput = output;
+  }
+  void SendMaxima(wxString s, bool history = false, bool ahead = false);
   void OpenFile(wxString file,
                 wxString command = wxEmptyString); // Open a file
   bool DocumentSaved() { return m_fileSaved; }
@@ -118,11 +151,19 @@ protected:
 
   void ServerEvent(wxSocketEvent& event);          // server event: maxima connection
   void ClientEvent(wxSocketEvent& event);          // client event: maxima input/output
+  void StdioEvent(wxTimerEvent& event);            // maxima output with m_stdio
+  void KernelTimerEvent(wxTimerEvent& event);      // additional processes which don't start
+  void KernelEvent(wxSocketEvent& event);          // input/output of additional maxima processes
 
   void ConsoleAppend(wxString s, int type);        // append maxima output to console
   void DoConsoleAppend(wxString s, int type,       //
                        bool newLine = true, bool bigSkip = true);
   void DoRawConsoleAppend(wxString s, int type);   //
+  void QueueJob(ParserJob *job);                   // parse output in order, in the parser thread if possible
+  void HandleJob(ParserJob *job, GroupCell *group = NULL); // add parsed output to console
+  void OnParserThread(wxCommandEvent& event);      // parser thread finished some jobs
+  void StartParserThread();                        //
+  void StopParserThread(bool handleJobs);          //
 
   void EditInputMenu(wxCommandEvent& event);       //
   void EvaluateEvent(wxCommandEvent& event);       //
@@ -132,7 +173,20 @@ protected:
   void OnInspectorEvent(wxCommandEvent& ev);
   void DumpProcessOutput();
   void TryEvaluateNextInQueue();
+  void SendAhead();                  // sends queued cells while maxima is busy
+  void SendAnswerMark();             // maxima asked a question, see wx-call-with-answer
+  void TakeFromCache();              // output of queued cells from the result cache
+  void ReplayCacheDebt(GroupCell *group);
+  void EvaluateParallel();           // evaluates sections in the additional processes
+  void EvaluateStale();              // evaluates cells whose dependencies changed
+  void TimeEvaluated(GroupCell *group); // records when the output of group is done
+  void ShowEvaluationTimes();        //
   void TryUpdateInspector();
+  void StartBatch();                 // evaluates the document in batch mode
+  void ReportBatchCell();            //
+  void FinishBatch(int code);        // exports the document and exits
+  void ReportError(wxString message, wxString caption,
+                   long style = wxOK | wxICON_ERROR);
 
 #if WXM_PRINT
   void CheckForPrintingSupport();
@@ -146,21 +200,58 @@ protected:
   void OnClose(wxCloseEvent& event);               // close wxMaxima window
   wxString GetCommand(bool params = true);         // returns the command to start maxima
                                                    //    (uses guessConfiguration)
+  wxString GetStartCommand(bool stdio);            // GetCommand with the port of the server
+  void InterruptProcess(long pid);                 //
+
+  void StartKernels();               // starts the additional maxima processes
+  void LaunchKernel();               // starts the next one which is not running
+  void MoveKernelQueue(MaximaKernel *kernel); // to the main queue
+  bool LaunchProcess(MaximaKernel *kernel);
+  void StartSpare();                 // starts the process used by SwapInSpare
+  bool SwapInSpare();                // restarts maxima by replacing it with the spare
+  bool TakeSpareFrom(wxMaxima *donor); // starts with the spare of another window
+  void UseKernel(MaximaKernel *kernel); // makes kernel the main maxima process
+  void StopKernels();                //
+  void ReadKernel(MaximaKernel *kernel);
+  void KernelAppend(MaximaKernel *kernel, wxString s, int type = MC_TYPE_DEFAULT);
+  void KernelPrompt(MaximaKernel *kernel, wxString o);
+  void TryEvaluateKernel(MaximaKernel *kernel);
+  void UpdateKernelStatus();
 
   void ReadFirstPrompt();            // reads everything before first prompt
   // setsup m_pid
   void ReadPrompt();                 // reads prompts
+  void HandlePrompt(wxString o);     // acts on a prompt
+  void FlushOutputTail();            // shows the end of output over the limit
   void ReadMath();                   // reads output other than prompts
   void ReadLispError();              // lisp errors (no prompt prefix/suffix)
   void ReadLoadSymbols();            // functions after load command
+  void ReadFramingAck();             // maxima switched to framed output
+  void ReadFramed();                 // reads framed output
+  void ReadOutput();                 // reads all complete output
+  void ReceiveOutput(const char *buffer, int read); // handles output read from maxima
+  void ReadStdio();                  // reads the standard output of maxima
+  wxString GetSessionFile();         // session snapshot of m_currentFile
+  wxString GetSessionKey();          // the document and maxima a snapshot belongs to
+  void SendQuiet(wxString command);  // :lisp-quiet command, no prompt follows
+  void SaveSession();
+  void RestoreSession();
+  void CancelOutput();               // discards output of interrupted command
+  bool SkipCancelledOutput();        // skips it until the next prompt
+  void HandleRecord(wxChar type, wxString payload);
+  void AddSymbols(wxString symbols); //
 #ifndef __WXMSW__
   void ReadProcessOutput();          // reads output of maxima command
 #endif
 
   void SetupVariables();             // sets some maxima variables
+  wxArrayString GetSetupCommands();  //    the commands which do it
+  void ConvertSpecialChars(wxString& s); // replaces unicode characters maxima doesn't know
+  long ReadPid(wxString output);     // pid from the first prompt
   void KillMaxima();                 // kills the maxima process
   void ResetTitle(bool saved);
   void FirstOutput(wxString s);
+  void LoadSymbols();                // the index for autocompletion
 
   // loading functions
   bool OpenWXMFile(wxString file, MathCtrl *document, bool clearDocument = true);
@@ -178,17 +269,48 @@ protected:
   long m_pid;
   wxProcess *m_process;
   wxInputStream *m_input;
+  bool m_stdio;                     // maxima talks through stdin and stdout
+  wxTimer m_stdioTimer;             // reads the output of maxima with m_stdio
   int m_port;
-  wxString m_currentOutput;
+  OutputScanner m_currentOutput;
+  SendQueue m_sendQueue;            // input waiting until maxima reads it
+  OutputBudget m_outputBudget;
+  ResultCache m_resultCache;
+  wxArrayString m_cacheDebt;        // input of cells taken from the cache
+  int m_replaying;                  // inputs from m_cacheDebt maxima still evaluates
+  DependencyGraph m_dependencies;
+  SessionRecorder m_recorder;       // writes the socket traffic to a file
+  SessionReplay *m_replay;          // stands in for maxima
+  bool m_batchMode;                 // no window, evaluate m_openFile and exit
+  wxString m_batchOutput;
+  wxStopWatch m_batchTimer;         // time of the current cell
+  wxStopWatch m_batchTotal;
+  int m_batchCell;
+  int m_batchErrors;
   wxString m_promptSuffix;
   wxString m_promptPrefix;
   wxString m_firstPrompt;
   bool m_readingPrompt;
+  bool m_framed;                    // maxima sends framed records
+  int m_inFlight;                   // cells from the queue sent to maxima
+  bool m_atPrompt;                  // maxima waits for input
+  bool m_cancelled;                 // output until the next prompt is discarded
+  long m_discarded;                 // characters discarded after an interrupt
+  int m_pipelineDepth;              // how many cells can be sent at once
+  bool m_questionPending;           // maxima waits for the answer to a question
+  bool m_saveSessionPending;        // save the session at the next main prompt
+  wxStopWatch m_runTimer;           // time of the last evaluation of the queue
+  long m_runTime;                   // in ms, -1 while it runs
+  int m_runCells;                   // cells evaluated in it
+  MaximaKernel *m_kernels;          // additional maxima processes
+  MaximaKernel *m_spare;            // warm standby for restarting maxima
+  wxTimer m_kernelTimer;            // runs while additional processes start
   bool m_dispReadOut;               // what is displayed in statusbar
   bool m_inLispMode;                // don't add ; in lisp mode
   wxString m_lastPrompt;
   wxString m_lastPath;
   MathParser m_MParser;
+  ParserThread *m_parserThread;
   wxPrintData* m_printData;
 #if WXM_PRINT
   bool m_supportPrinting;
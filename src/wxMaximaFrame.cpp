@@ -46,12 +46,12 @@ wxMaximaFrame::wxMaximaFrame(wxWindow* parent, int id, const wxString& title,
 #endif
 
 
-  CreateStatusBar(2);
+  CreateStatusBar(3);
   int widths[] =
     {
-      -1, 300
+      -1, 300, 200
     };
-  SetStatusWidths(2, widths);
+  SetStatusWidths(3, widths);
 
 #if defined __WXMSW__
   wxAcceleratorEntry entries[1];
@@ -289,8 +289,16 @@ void wxMaximaFrame::SetupMenu()
   wxglade_tmp_menu_2 = new wxMenu;
   wxglade_tmp_menu_2->Append(menu_evaluate, _("Evaluate Cell(s)"),
                              _("Evaluate active or selected cell(s)"), wxITEM_NORMAL);
+  wxglade_tmp_menu_2->Append(menu_evaluate_next, _("Evaluate Cell Next"),
+                               _("Move the active cell to the front of the evaluation queue"), wxITEM_NORMAL);
   wxglade_tmp_menu_2->Append(menu_evaluate_all, _("Evaluate All Cells\tCtrl-R"),
                                _("Evaluate all cells in the document"), wxITEM_NORMAL);
+  wxglade_tmp_menu_2->Append(menu_evaluate_stale, _("Evaluate Changed Cells"),
+                               _("Evaluate the cells which changed since they were evaluated and the cells which depend on them"), wxITEM_NORMAL);
+  wxglade_tmp_menu_2->Append(menu_evaluate_parallel, _("Evaluate Sections in Parallel"),
+                               _("Evaluate the sections of the document in separate Maxima processes"), wxITEM_NORMAL);
+  wxglade_tmp_menu_2->Append(menu_evaluation_times, _("Evaluation Times..."),
+                               _("Show how long the evaluation of each cell took"), wxITEM_NORMAL);
   wxglade_tmp_menu_2->Append(menu_remove_output, _("Remove All Output"),
                             _("Remove output from input cells"), wxITEM_NORMAL);
   wxglade_tmp_menu_2->AppendSeparator();
@@ -35,6 +35,8 @@
 enum {
   socket_client_id = wxID_HIGHEST,
   socket_server_id,
+  kernel_socket_id,
+  parser_thread_id,
   plot_slider_id,
   input_line_id,
   menu_new_id,
@@ -156,6 +158,10 @@ enum {
   menu_bug_report,
   menu_add_path,
   menu_evaluate_all,
+  menu_evaluate_next,
+  menu_evaluate_parallel,
+  menu_evaluate_stale,
+  menu_evaluation_times,
   menu_show_tip,
   menu_copy_from_console,
   menu_copy_tex_from_console,